@@ -3,7 +3,10 @@
 #include <string.h>
 #include <stdio.h>
 #include "devices/ide.h"
+#include "devices/timer.h"
 #include "threads/malloc.h"
+#include "threads/thread.h"
+#include "threads/trace.h"
 
 /* A block device. */
 struct block
@@ -120,9 +123,14 @@ check_sector (struct block *block, block_sector_t sector)
 void
 block_read (struct block *block, block_sector_t sector, void *buffer)
 {
+  int64_t start;
+
   check_sector (block, sector);
+  start = timer_ns ();
+  trace (TRACE_BLOCK_READ, sector, block->type);
   block->ops->read (block->aux, sector, buffer);
   block->read_cnt++;
+  thread_current ()->usage.io_wait_ns += timer_ns () - start;
 }
 
 /* Write sector SECTOR to BLOCK from BUFFER, which must contain
@@ -133,10 +141,15 @@ block_read (struct block *block, block_sector_t sector, void *buffer)
 void
 block_write (struct block *block, block_sector_t sector, const void *buffer)
 {
+  int64_t start;
+
   check_sector (block, sector);
   ASSERT (block->type != BLOCK_FOREIGN);
+  start = timer_ns ();
+  trace (TRACE_BLOCK_WRITE, sector, block->type);
   block->ops->write (block->aux, sector, buffer);
   block->write_cnt++;
+  thread_current ()->usage.io_wait_ns += timer_ns () - start;
 }
 
 /* Returns the number of sectors in BLOCK. */
@@ -124,8 +124,10 @@ ide_init (void)
           NOT_REACHED ();
         }
       lock_init (&c->lock);
+      lock_set_name (&c->lock, c->name);
       c->expecting_interrupt = false;
       sema_init (&c->completion_wait, 0);
+      sema_set_name (&c->completion_wait, "ide completion");
  
       /* Initialize devices. */
       for (dev_no = 0; dev_no < 2; dev_no++)
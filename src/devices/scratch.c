@@ -0,0 +1,75 @@
+#include "devices/scratch.h"
+#include <debug.h>
+#include <stdint.h>
+#include <string.h>
+#include "devices/block.h"
+
+/* The scratch device, once opened. */
+static struct block *scratch;
+
+/* Next sector to write. */
+static block_sector_t sector;
+
+/* Bytes of the current sector buffered so far. */
+static uint8_t buffer[BLOCK_SECTOR_SIZE];
+static size_t buffer_ofs;
+
+/* Prepares to write dumps to the scratch device.  Returns true
+   if successful, false if there is no scratch device.  Dumps
+   are meant to be written while the kernel shuts down, by one
+   thread, so there is no locking. */
+bool
+scratch_dump_open (void)
+{
+  if (scratch == NULL)
+    scratch = block_get_role (BLOCK_SCRATCH);
+  return scratch != NULL;
+}
+
+/* Returns the number of bytes that can still be written to the
+   scratch device. */
+size_t
+scratch_dump_avail (void)
+{
+  ASSERT (scratch != NULL);
+
+  return (block_size (scratch) - sector) * BLOCK_SECTOR_SIZE - buffer_ofs;
+}
+
+/* Appends SIZE bytes from DATA to the scratch device.  Data
+   beyond the end of the device is discarded. */
+void
+scratch_dump_write (const void *data_, size_t size)
+{
+  const uint8_t *data = data_;
+
+  ASSERT (scratch != NULL);
+
+  while (size > 0 && sector < block_size (scratch))
+    {
+      size_t chunk = BLOCK_SECTOR_SIZE - buffer_ofs;
+      if (chunk > size)
+        chunk = size;
+      memcpy (buffer + buffer_ofs, data, chunk);
+      buffer_ofs += chunk;
+      data += chunk;
+      size -= chunk;
+      if (buffer_ofs == BLOCK_SECTOR_SIZE)
+        scratch_dump_flush ();
+    }
+}
+
+/* Writes out the partially filled current sector, if any,
+   padded with zeros, so that the next write starts a new
+   sector. */
+void
+scratch_dump_flush (void)
+{
+  ASSERT (scratch != NULL);
+
+  if (buffer_ofs == 0)
+    return;
+  memset (buffer + buffer_ofs, 0, BLOCK_SECTOR_SIZE - buffer_ofs);
+  block_write (scratch, sector++, buffer);
+  buffer_ofs = 0;
+}
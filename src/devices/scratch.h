@@ -0,0 +1,16 @@
+#ifndef DEVICES_SCRATCH_H
+#define DEVICES_SCRATCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Sequential dumps to the scratch block device, used to save
+   diagnostic data at power off.  Successive dumps are written
+   one after another, each starting on a sector boundary. */
+
+bool scratch_dump_open (void);
+size_t scratch_dump_avail (void);
+void scratch_dump_write (const void *, size_t);
+void scratch_dump_flush (void);
+
+#endif /* devices/scratch.h */
@@ -5,12 +5,18 @@
 #include "devices/serial.h"
 #include "devices/timer.h"
 #include "threads/io.h"
+#include "threads/palloc.h"
+#include "threads/profile.h"
+#include "threads/slab.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
 #ifdef USERPROG
 #include "userprog/exception.h"
 #endif
 #ifdef FILESYS
 #include "devices/block.h"
+#include "filesys/cache.h"
 #include "filesys/filesys.h"
 #endif
 
@@ -93,6 +99,8 @@ shutdown_power_off (void)
 #ifdef FILESYS
   filesys_done ();
 #endif
+  trace_dump ();
+  profile_dump ();
 
   print_stats ();
 
@@ -131,8 +139,12 @@ print_stats (void)
 {
   timer_print_stats ();
   thread_print_stats ();
+  lock_print_stats ();
+  kmem_print_stats ();
+  palloc_print_stats ();
 #ifdef FILESYS
   block_print_stats ();
+  cache_print_stats ();
 #endif
   console_print_stats ();
   kbd_print_stats ();
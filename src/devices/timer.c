@@ -1,12 +1,15 @@
 #include "devices/timer.h"
+#include <cpuid.h>
 #include <debug.h>
 #include <inttypes.h>
 #include <round.h>
 #include <stdio.h>
 #include "devices/pit.h"
 #include "threads/interrupt.h"
+#include "threads/profile.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
+#include "threads/vaddr.h"
   
 /* See [8254] for hardware details of the 8254 timer chip. */
 
@@ -20,21 +23,45 @@
 /* Number of timer ticks since OS booted. */
 static int64_t ticks;
 
+/* Threads blocked in timer_sleep(), ordered by wakeup_tick, and
+   the earliest wakeup_tick among them (INT64_MAX if none), so
+   that the timer interrupt can tell in O(1) whether anything is
+   due.  Both are protected by disabling interrupts. */
+static struct list sleep_list;
+static int64_t next_wakeup;
+
 /* Number of loops per timer tick.
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
 
+/* Time stamp counter frequency in Hz, or 0 if the CPU has no
+   TSC or it has not been calibrated yet, and the TSC value at
+   calibration time, which timer_ns() counts from.  Initialized
+   by timer_calibrate(). */
+#define TSC_CALIBRATE_TICKS 8
+static uint64_t tsc_hz;
+static uint64_t tsc_base;
+static int64_t tsc_base_ticks;
+
 static intr_handler_func timer_interrupt;
 static bool too_many_loops (unsigned loops);
 static void busy_wait (int64_t loops);
 static void real_time_sleep (int64_t num, int32_t denom);
 static void real_time_delay (int64_t num, int32_t denom);
+static bool tsc_present (void);
+static inline uint64_t rdtsc (void);
+static bool wakeup_less (const struct list_elem *, const struct list_elem *,
+                         void *aux);
+static void wake_sleepers (void);
 
 /* Sets up the timer to interrupt TIMER_FREQ times per second,
    and registers the corresponding interrupt. */
 void
 timer_init (void) 
 {
+  list_init (&sleep_list);
+  next_wakeup = INT64_MAX;
+
   pit_configure_channel (0, 2, TIMER_FREQ);
   intr_register_ext (0x20, timer_interrupt, "8254 Timer");
 }
@@ -64,6 +91,27 @@ timer_calibrate (void)
       loops_per_tick |= test_bit;
 
   printf ("%'"PRIu64" loops/s.\n", (uint64_t) loops_per_tick * TIMER_FREQ);
+
+  /* Count TSC cycles across a few whole ticks.  timer_ns()
+     interpolates between ticks with the result. */
+  if (tsc_present ())
+    {
+      int64_t start;
+      uint64_t tsc_start;
+
+      start = ticks;
+      while (ticks == start)
+        barrier ();
+      start = ticks;
+      tsc_start = rdtsc ();
+      while (ticks - start < TSC_CALIBRATE_TICKS)
+        barrier ();
+
+      tsc_base = rdtsc ();
+      tsc_base_ticks = ticks;
+      tsc_hz = (tsc_base - tsc_start) * TIMER_FREQ / TSC_CALIBRATE_TICKS;
+      printf ("TSC runs at %'"PRIu64" Hz.\n", tsc_hz);
+    }
 }
 
 /* Returns the number of timer ticks since the OS booted. */
@@ -84,16 +132,50 @@ timer_elapsed (int64_t then)
   return timer_ticks () - then;
 }
 
+/* Returns the number of nanoseconds since the OS booted, from a
+   monotonic clock.  Once timer_calibrate() has measured the time
+   stamp counter, the result has sub-microsecond resolution;
+   before that, or on CPUs without a TSC, it only advances once
+   per timer tick.  May be called from any context. */
+int64_t
+timer_ns (void) 
+{
+  uint64_t delta;
+
+  if (tsc_hz == 0)
+    return timer_ticks () * (NSEC_PER_SEC / TIMER_FREQ);
+
+  /* Split the cycle count into whole seconds and a remainder
+     so that the multiplication cannot overflow. */
+  delta = rdtsc () - tsc_base;
+  return (tsc_base_ticks * (NSEC_PER_SEC / TIMER_FREQ)
+          + delta / tsc_hz * NSEC_PER_SEC
+          + delta % tsc_hz * NSEC_PER_SEC / tsc_hz);
+}
+
 /* Sleeps for approximately TICKS timer ticks.  Interrupts must
-   be turned on. */
+   be turned on.
+
+   The calling thread is blocked on the sleep queue until the
+   timer interrupt finds its deadline has passed, so sleeping
+   threads cost nothing until then. */
 void
 timer_sleep (int64_t ticks) 
 {
-  int64_t start = timer_ticks ();
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
 
   ASSERT (intr_get_level () == INTR_ON);
-  while (timer_elapsed (start) < ticks) 
-    thread_yield ();
+  if (ticks <= 0)
+    return;
+
+  old_level = intr_disable ();
+  cur->wakeup_tick = timer_ticks () + ticks;
+  list_insert_ordered (&sleep_list, &cur->elem, wakeup_less, NULL);
+  if (cur->wakeup_tick < next_wakeup)
+    next_wakeup = cur->wakeup_tick;
+  thread_block ();
+  intr_set_level (old_level);
 }
 
 /* Sleeps for approximately MS milliseconds.  Interrupts must be
@@ -168,10 +250,63 @@ timer_print_stats (void)
 
 /* Timer interrupt handler. */
 static void
-timer_interrupt (struct intr_frame *args UNUSED)
+timer_interrupt (struct intr_frame *args)
 {
   ticks++;
-  thread_tick ();
+  if (profile_enabled)
+    profile_sample (args);
+  if (ticks >= next_wakeup)
+    wake_sleepers ();
+  thread_tick (is_user_vaddr (args->eip));
+}
+
+/* Returns true if the sleeping thread containing A_ wakes up
+   before the one containing B_. */
+static bool
+wakeup_less (const struct list_elem *a_, const struct list_elem *b_,
+             void *aux UNUSED)
+{
+  const struct thread *a = list_entry (a_, struct thread, elem);
+  const struct thread *b = list_entry (b_, struct thread, elem);
+
+  return a->wakeup_tick < b->wakeup_tick;
+}
+
+/* Unblocks every sleeping thread whose deadline has passed and
+   updates next_wakeup.  Runs in the timer interrupt. */
+static void
+wake_sleepers (void)
+{
+  while (!list_empty (&sleep_list))
+    {
+      struct thread *t = list_entry (list_front (&sleep_list),
+                                     struct thread, elem);
+      if (t->wakeup_tick > ticks)
+        break;
+      list_pop_front (&sleep_list);
+      thread_unblock (t);
+    }
+
+  next_wakeup = (list_empty (&sleep_list) ? INT64_MAX
+                 : list_entry (list_front (&sleep_list),
+                               struct thread, elem)->wakeup_tick);
+  thread_preempt ();
+}
+
+/* Returns true if the CPU has a time stamp counter. */
+static bool
+tsc_present (void) 
+{
+  return (cpuid_features () & CPUID_TSC) != 0;
+}
+
+/* Reads the time stamp counter.  See [IA32-v2b] "RDTSC". */
+static inline uint64_t
+rdtsc (void) 
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
 }
 
 /* Returns true if LOOPS iterations waits for more than one timer
@@ -227,9 +362,17 @@ real_time_sleep (int64_t num, int32_t denom)
          processes. */                
       timer_sleep (ticks); 
     }
+  else if (tsc_hz != 0)
+    {
+      /* Otherwise, wait out the sub-tick remainder against the
+         TSC, letting other ready threads run in the meantime. */
+      int64_t deadline = timer_ns () + num * (NSEC_PER_SEC / denom);
+      while (timer_ns () < deadline)
+        thread_yield ();
+    }
   else 
     {
-      /* Otherwise, use a busy-wait loop for more accurate
+      /* Without a TSC, use a busy-wait loop for more accurate
          sub-tick timing. */
       real_time_delay (num, denom); 
     }
@@ -242,5 +385,16 @@ real_time_delay (int64_t num, int32_t denom)
   /* Scale the numerator and denominator down by 1000 to avoid
      the possibility of overflow. */
   ASSERT (denom % 1000 == 0);
+
+  if (tsc_hz != 0)
+    {
+      /* Spin on the TSC, which is exact regardless of how the
+         loop below happens to be aligned or interrupted. */
+      uint64_t cycles = tsc_hz * num / 1000 / (denom / 1000);
+      uint64_t start = rdtsc ();
+      while (rdtsc () - start < cycles)
+        barrier ();
+      return;
+    }
   busy_wait (loops_per_tick * num / 1000 * TIMER_FREQ / (denom / 1000)); 
 }
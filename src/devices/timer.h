@@ -7,12 +7,18 @@
 /* Number of timer interrupts per second. */
 #define TIMER_FREQ 100
 
+/* Nanoseconds per second. */
+#define NSEC_PER_SEC 1000000000LL
+
 void timer_init (void);
 void timer_calibrate (void);
 
 int64_t timer_ticks (void);
 int64_t timer_elapsed (int64_t);
 
+/* High-resolution monotonic clock. */
+int64_t timer_ns (void);
+
 /* Sleep and yield the CPU to other threads. */
 void timer_sleep (int64_t ticks);
 void timer_msleep (int64_t milliseconds);
@@ -5,6 +5,7 @@
 
 static void read_line (char line[], size_t);
 static bool backspace (char **pos, char line[]);
+static void print_usage (const struct rusage *before);
 
 int
 main (void)
@@ -32,9 +33,16 @@ main (void)
         }
       else
         {
-          pid_t pid = exec (command);
+          struct rusage before;
+          pid_t pid;
+
+          getrusage (RUSAGE_CHILDREN, &before);
+          pid = exec (command);
           if (pid != PID_ERROR)
-            printf ("\"%s\": exit code %d\n", command, wait (pid));
+            {
+              printf ("\"%s\": exit code %d\n", command, wait (pid));
+              print_usage (&before);
+            }
           else
             printf ("exec failed\n");
         }
@@ -102,3 +110,26 @@ backspace (char **pos, char line[])
   else
     return false;
 }
+
+/* Prints the resources used by the command just waited for,
+   computed as the growth in the usage of all waited-for
+   children since BEFORE. */
+static void
+print_usage (const struct rusage *before)
+{
+  struct rusage after;
+
+  if (getrusage (RUSAGE_CHILDREN, &after) < 0)
+    return;
+  printf ("%lld user ticks, %lld kernel ticks, %lld ms I/O wait, "
+          "%u faults, %u+%u switches, %llu bytes read, "
+          "%llu bytes written\n",
+          after.user_ticks - before->user_ticks,
+          after.kernel_ticks - before->kernel_ticks,
+          (after.io_wait_ns - before->io_wait_ns) / 1000000,
+          after.page_faults - before->page_faults,
+          after.voluntary_switches - before->voluntary_switches,
+          after.involuntary_switches - before->involuntary_switches,
+          after.bytes_read - before->bytes_read,
+          after.bytes_written - before->bytes_written);
+}
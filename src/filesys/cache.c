@@ -1,11 +1,14 @@
 #include "filesys/cache.h"
 #include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
 #include <string.h>
 #include "filesys/filesys.h"
 #include "devices/timer.h"
 #include "threads/malloc.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
 
 #define INVALID_SECTOR ((block_sector_t) -1)
 
@@ -15,6 +18,9 @@ struct cache_block cache[CACHE_CNT];
 struct lock cache_sync;
 static int hand = 0;
 
+/* Statistics. */
+static struct cache_stats stats;
+
 
 static void flushd_init (void);
 static void readaheadd_init (void);
@@ -37,6 +43,8 @@ cache_init (void)
     cache[i].used = false;
     cache[i].dirty = false;
   }
+  memset (&stats, 0, sizeof stats);
+  stats.block_cnt = CACHE_CNT;
 }
 
 /* Flush cache to disk. */
@@ -44,10 +52,13 @@ void
 cache_flush ()
 {
   struct cache_block *b;
+  stats.flushes++;
   for (int i = 0; i < CACHE_CNT; i++){
     b = &cache[i];
-    if (b->dirty)
+    if (b->dirty){
       block_write(fs_device, b->sector, b->data);
+      stats.flushed_blocks++;
+    }
     }
 }
 
@@ -67,9 +78,12 @@ get_block_in_cache (block_sector_t sector)
   struct cache_block *b;
   for (int i = 0; i < CACHE_CNT; i++){
     b = &cache[i];
-    if (b->sector == sector)
+    if (b->sector == sector){
+      stats.probes += i + 1;
       return b;
+    }
   }
+  stats.probes += CACHE_CNT;
   return NULL;
 }
 
@@ -93,6 +107,7 @@ get_free_block (block_sector_t sector)
 
 static void
 inc_hand(void){
+  stats.hand_moves++;
   hand++;
   if (hand == CACHE_CNT)
     hand = 0;
@@ -108,9 +123,13 @@ cache_read (block_sector_t sector)
 
   /* Is the block already in-cache? */
   if ((b = get_block_in_cache(sector)) != NULL){
+    stats.hits++;
     goto done;
   }
 
+  stats.misses++;
+  trace (TRACE_CACHE_MISS, sector, 0);
+
   /* Not in cache.  Find empty slot. */
   if ((b = get_free_block(sector)) != NULL){
     block_read (fs_device, sector, b->data);
@@ -122,6 +141,9 @@ cache_read (block_sector_t sector)
   while(1){
     b = &cache[hand];
     if (b->used == false){
+      stats.evictions++;
+      if (b->dirty)
+        stats.dirty_evictions++;
       cache_write(b);
       block_read (fs_device, sector, b->data);
       b->sector = sector;
@@ -165,3 +187,27 @@ cache_free (block_sector_t sector)
   if (b != NULL)
     b->sector = -1;
 }
+
+/* Copies the cache statistics into *S. */
+void
+cache_get_stats (struct cache_stats *s)
+{
+  *s = stats;
+}
+
+/* Prints cache statistics. */
+void
+cache_print_stats (void)
+{
+  uint64_t lookups = stats.hits + stats.misses;
+  uint64_t probes_x10 = lookups > 0 ? stats.probes * 10 / lookups : 0;
+
+  printf ("Cache: %"PRIu64" hits, %"PRIu64" misses, "
+          "%"PRIu64".%"PRIu64" slots scanned per lookup\n",
+          stats.hits, stats.misses, probes_x10 / 10, probes_x10 % 10);
+  printf ("Cache: %"PRIu64" evictions (%"PRIu64" dirty), "
+          "%"PRIu64" clock hand moves, "
+          "%"PRIu64" flushes writing %"PRIu64" blocks\n",
+          stats.evictions, stats.dirty_evictions, stats.hand_moves,
+          stats.flushes, stats.flushed_blocks);
+}
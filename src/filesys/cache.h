@@ -2,6 +2,7 @@
 #define FILESYS_CACHE_H
 
 #include "devices/block.h"
+#include <cachestat.h>
 #include <stdbool.h>
 
 struct cache_block
@@ -19,5 +20,7 @@ struct cache_block *cache_read (block_sector_t);
 void *cache_zero (struct cache_block *);
 void cache_dirty (struct cache_block *);
 void cache_free (block_sector_t);
+void cache_get_stats (struct cache_stats *);
+void cache_print_stats (void);
 
 #endif /* filesys/cache.h */
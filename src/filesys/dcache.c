@@ -0,0 +1,233 @@
+#include "filesys/dcache.h"
+#include <debug.h>
+#include <hash.h>
+#include <string.h>
+#include "filesys/directory.h"
+#include "threads/synch.h"
+
+/* Dentry cache.
+
+   Maps (directory inode sector, name) pairs to the sector of the
+   named inode, so that path resolution can skip the directory
+   search for components it has seen before.  Names that were
+   looked up and not found are cached too, as negative entries.
+
+   The cache has a fixed number of entries, recycled in
+   approximately LRU order by the clock algorithm.  A hit only
+   sets its entry's `referenced' flag, so lookups, which far
+   outnumber changes, need the cache's lock only for reading.
+   The directory code keeps it coherent: dir_add() and
+   dir_remove() update the entry for the name they change, and
+   inode_close() purges every entry under a directory whose
+   sector is being freed, so that a later directory allocated in
+   the same sector cannot see stale names. */
+
+/* Number of cached names. */
+#define DCACHE_CNT 128
+
+/* Sector stored in negative entries. */
+#define NEGATIVE_SECTOR ((block_sector_t) -1)
+
+/* A cached directory entry. */
+struct dentry
+  {
+    struct hash_elem hash_elem;         /* Element in dcache_hash. */
+    bool in_hash;                       /* Currently in dcache_hash? */
+    bool referenced;                    /* Hit since the clock hand passed? */
+    block_sector_t dir;                 /* Containing directory. */
+    block_sector_t sector;              /* Inode, or NEGATIVE_SECTOR. */
+    char name[NAME_MAX + 1];            /* Null terminated name. */
+  };
+
+static struct dentry dentries[DCACHE_CNT];
+
+/* Cached entries, keyed on (dir, name). */
+static struct hash dcache_hash;
+
+/* Next entry for the clock algorithm to consider recycling. */
+static size_t clock_hand;
+
+/* Protects all of the above, except that lookups holding it for
+   reading may set `referenced'. */
+static struct rwlock dcache_lock;
+
+static hash_hash_func dentry_hash;
+static hash_less_func dentry_less;
+
+/* Initializes the dentry cache. */
+void
+dcache_init (void)
+{
+  size_t i;
+
+  hash_init (&dcache_hash, dentry_hash, dentry_less, NULL);
+  rwlock_init (&dcache_lock);
+  rwlock_set_name (&dcache_lock, "dcache_lock");
+  clock_hand = 0;
+  for (i = 0; i < DCACHE_CNT; i++)
+    {
+      dentries[i].in_hash = false;
+      dentries[i].referenced = false;
+    }
+}
+
+/* Returns the cached entry for NAME in DIR, or a null pointer.
+   Must be called with dcache_lock held. */
+static struct dentry *
+find (block_sector_t dir, const char *name)
+{
+  struct dentry key;
+  struct hash_elem *e;
+
+  key.dir = dir;
+  strlcpy (key.name, name, sizeof key.name);
+  e = hash_find (&dcache_hash, &key.hash_elem);
+  return e != NULL ? hash_entry (e, struct dentry, hash_elem) : NULL;
+}
+
+/* Looks up NAME in the directory whose inode is in sector DIR.
+   On DCACHE_HIT, stores the named inode's sector in *SECTOR. */
+enum dcache_result
+dcache_lookup (block_sector_t dir, const char *name, block_sector_t *sector)
+{
+  enum dcache_result result = DCACHE_MISS;
+  struct dentry *d;
+
+  if (strlen (name) > NAME_MAX)
+    return DCACHE_MISS;
+
+  rwlock_acquire_read (&dcache_lock);
+  d = find (dir, name);
+  if (d != NULL)
+    {
+      /* Concurrent readers all store the same value here. */
+      d->referenced = true;
+      if (d->sector == NEGATIVE_SECTOR)
+        result = DCACHE_NEGATIVE;
+      else
+        {
+          *sector = d->sector;
+          result = DCACHE_HIT;
+        }
+    }
+  rwlock_release_read (&dcache_lock);
+  return result;
+}
+
+/* Chooses an entry to recycle and returns it.  Prefers unused
+   entries, then entries not hit since the clock hand last
+   passed them.  Must be called with dcache_lock held for
+   writing. */
+static struct dentry *
+choose_victim (void)
+{
+  for (;;)
+    {
+      struct dentry *d = &dentries[clock_hand];
+      clock_hand = (clock_hand + 1) % DCACHE_CNT;
+      if (!d->in_hash || !d->referenced)
+        return d;
+      d->referenced = false;
+    }
+}
+
+/* Records that NAME in DIR refers to SECTOR, replacing any
+   existing entry. */
+static void
+insert (block_sector_t dir, const char *name, block_sector_t sector)
+{
+  struct dentry *d;
+
+  if (strlen (name) > NAME_MAX)
+    return;
+
+  rwlock_acquire_write (&dcache_lock);
+  d = find (dir, name);
+  if (d == NULL)
+    {
+      d = choose_victim ();
+      if (d->in_hash)
+        hash_delete (&dcache_hash, &d->hash_elem);
+      d->dir = dir;
+      strlcpy (d->name, name, sizeof d->name);
+      hash_insert (&dcache_hash, &d->hash_elem);
+      d->in_hash = true;
+    }
+  d->sector = sector;
+  d->referenced = true;
+  rwlock_release_write (&dcache_lock);
+}
+
+/* Records that NAME in DIR refers to the inode in SECTOR. */
+void
+dcache_insert (block_sector_t dir, const char *name, block_sector_t sector)
+{
+  ASSERT (sector != NEGATIVE_SECTOR);
+  insert (dir, name, sector);
+}
+
+/* Records that DIR contains no entry named NAME. */
+void
+dcache_insert_negative (block_sector_t dir, const char *name)
+{
+  insert (dir, name, NEGATIVE_SECTOR);
+}
+
+/* Drops D from the cache, so that it is free to be recycled.
+   Must be called with dcache_lock held for writing. */
+static void
+drop (struct dentry *d)
+{
+  hash_delete (&dcache_hash, &d->hash_elem);
+  d->in_hash = false;
+}
+
+/* Forgets anything cached about NAME in DIR. */
+void
+dcache_invalidate (block_sector_t dir, const char *name)
+{
+  struct dentry *d;
+
+  if (strlen (name) > NAME_MAX)
+    return;
+
+  rwlock_acquire_write (&dcache_lock);
+  d = find (dir, name);
+  if (d != NULL)
+    drop (d);
+  rwlock_release_write (&dcache_lock);
+}
+
+/* Forgets every entry cached for directory DIR. */
+void
+dcache_purge_dir (block_sector_t dir)
+{
+  size_t i;
+
+  rwlock_acquire_write (&dcache_lock);
+  for (i = 0; i < DCACHE_CNT; i++)
+    if (dentries[i].in_hash && dentries[i].dir == dir)
+      drop (&dentries[i]);
+  rwlock_release_write (&dcache_lock);
+}
+
+/* Returns a hash value for dentry E. */
+static unsigned
+dentry_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct dentry *d = hash_entry (e, struct dentry, hash_elem);
+  return hash_string (d->name) ^ hash_int (d->dir);
+}
+
+/* Returns true if dentry A precedes dentry B. */
+static bool
+dentry_less (const struct hash_elem *a_, const struct hash_elem *b_,
+             void *aux UNUSED)
+{
+  const struct dentry *a = hash_entry (a_, struct dentry, hash_elem);
+  const struct dentry *b = hash_entry (b_, struct dentry, hash_elem);
+
+  if (a->dir != b->dir)
+    return a->dir < b->dir;
+  return strcmp (a->name, b->name) < 0;
+}
@@ -1,10 +1,86 @@
 #include "filesys/directory.h"
 #include <stdio.h>
 #include <string.h>
+#include <hash.h>
 #include <list.h>
+#include <round.h>
+#include "filesys/dcache.h"
+#include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
 #include "threads/malloc.h"
+#include "threads/slab.h"
+
+/* Directory formats.
+
+   A new directory is a plain array of struct dir_entry, starting
+   with "." and "..", searched linearly.  Once it holds more than
+   DIR_HASH_THRESHOLD entries, dir_add() transparently rewrites it
+   in the hashed format:
+
+     - Sector 0 keeps "." and ".." in slots 0 and 1, followed by
+       a struct dir_hash_header in slot 2.  The header is never
+       `in_use', so code that walks slots linearly skips it.
+
+     - Sectors 1 through bucket_cnt each hold one struct
+       dir_block, a bucket of DIR_SLOTS_PER_BLOCK entries.  A name
+       lives in the bucket chosen by its hash or, if that bucket
+       was full when it was added, in one of the following
+       buckets (wrapping around).  A bucket's `overflow' flag
+       records that some insertion probed past it, so lookups can
+       stop at the first bucket without the flag.
+
+   The bucket count doubles whenever the table gets 3/4 full,
+   which keeps lookups, adds and removes to about one sector. */
+
+/* Entry count above which a linear directory is converted. */
+#define DIR_HASH_THRESHOLD 64
+
+/* Minimum number of buckets in a hashed directory. */
+#define DIR_MIN_BUCKETS 4
+
+/* Identifies a hashed directory header. */
+#define DIR_HASH_MAGIC 0x48524944
+
+/* Byte offset of the header in a hashed directory. */
+#define DIR_HASH_HEADER_OFS (2 * sizeof (struct dir_entry))
+
+/* Directory entries in each bucket block. */
+#define DIR_SLOTS_PER_BLOCK ((BLOCK_SECTOR_SIZE - sizeof (uint32_t)) \
+                             / sizeof (struct dir_entry))
+
+/* Hashed directory header.
+   Must be exactly the size of a struct dir_entry. */
+struct dir_hash_header
+  {
+    uint32_t magic;                     /* DIR_HASH_MAGIC. */
+    uint32_t bucket_cnt;                /* Number of bucket blocks. */
+    uint32_t entry_cnt;                 /* Entries in buckets. */
+    uint8_t unused[sizeof (struct dir_entry) - 3 * sizeof (uint32_t)
+                   - sizeof (bool)];
+    bool in_use;                        /* Always false. */
+  };
+
+/* A bucket in a hashed directory, stored at the start of a
+   sector. */
+struct dir_block
+  {
+    struct dir_entry entries[DIR_SLOTS_PER_BLOCK];
+    uint32_t overflow;                  /* Nonzero once probed past. */
+  };
+
+static off_t bucket_ofs (size_t bucket);
+static bool read_hash_header (const struct dir *, struct dir_hash_header *);
+static bool write_hash_header (struct dir *, const struct dir_hash_header *);
+static bool hashed_lookup (const struct dir *, const struct dir_hash_header *,
+                           const char *name, struct dir_entry *, off_t *,
+                           bool *completep);
+static bool hashed_insert (struct dir *, const struct dir_hash_header *,
+                           const struct dir_entry *);
+static bool hashed_add (struct dir *, struct dir_hash_header *,
+                        const struct dir_entry *);
+static bool rehash (struct dir *, const struct dir_hash_header *,
+                    size_t entry_cnt);
 
 /* Creates a directory in the given SECTOR.
     The directory's parent is in PARENT_SECTOR.
@@ -36,17 +112,18 @@ dir_create (block_sector_t sector, block_sector_t parent_sector)
 struct dir *
 dir_open (struct inode *inode)
 {
-  struct dir *dir = calloc (1, sizeof *dir);
+  struct dir *dir = kmem_cache_alloc (file_cache);
   if (inode != NULL && dir != NULL)
     {
       dir->inode = inode;
       dir->pos = 2*sizeof(struct dir_entry);
+      dir->padding = false;
       return dir;
     }
   else
     {
       inode_close (inode);
-      free (dir);
+      kmem_cache_free (file_cache, dir);
       return NULL;
     }
 }
@@ -74,7 +151,7 @@ dir_close (struct dir *dir)
   if (dir != NULL)
     {
       inode_close (dir->inode);
-      free (dir);
+      kmem_cache_free (file_cache, dir);
     }
 }
 
@@ -89,17 +166,48 @@ dir_get_inode (struct dir *dir)
    If successful, returns true, sets *EP to the directory entry
    if EP is non-null, and sets *OFSP to the byte offset of the
    directory entry if OFSP is non-null.
-   otherwise, returns false and ignores EP and OFSP. */
+   otherwise, returns false and ignores EP and OFSP.
+   If COMPLETEP is non-null, sets *COMPLETEP to false if an error
+   such as a failed read or allocation cut the search short, and
+   to true otherwise, so that a false return with *COMPLETEP true
+   means that NAME really is absent. */
 static bool
 lookup (const struct dir *dir, const char *name,
-        struct dir_entry *ep, off_t *ofsp)
+        struct dir_entry *ep, off_t *ofsp, bool *completep)
 {
+  struct dir_hash_header h;
   struct dir_entry e;
   size_t ofs;
 
   ASSERT (dir != NULL);
   ASSERT (name != NULL);
 
+  if (completep != NULL)
+    *completep = true;
+
+  if (read_hash_header (dir, &h))
+    {
+      /* "." and ".." stay in sector 0, outside the buckets. */
+      for (ofs = 0; ofs < DIR_HASH_HEADER_OFS; ofs += sizeof e)
+        {
+          if (inode_read_at (dir->inode, &e, sizeof e, ofs) != sizeof e)
+            {
+              if (completep != NULL)
+                *completep = false;
+              return false;
+            }
+          if (e.in_use && !strcmp (name, e.name))
+            {
+              if (ep != NULL)
+                *ep = e;
+              if (ofsp != NULL)
+                *ofsp = ofs;
+              return true;
+            }
+        }
+      return hashed_lookup (dir, &h, name, ep, ofsp, completep);
+    }
+
   //printf("want to lookup %s, using sector %d\n", inode_get_inumber(dir->inode));
   for (ofs = 0; inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
        ofs += sizeof e)
@@ -122,15 +230,39 @@ bool
 dir_lookup (const struct dir *dir, const char *name,
             struct inode **inode)
 {
+  block_sector_t dir_sector, sector;
   struct dir_entry e;
+  bool complete;
 
   ASSERT (dir != NULL);
   ASSERT (name != NULL);
 
-  if (lookup (dir, name, &e, NULL))
-    *inode = inode_open (e.inode_sector);
+  dir_sector = inode_get_inumber (dir->inode);
+  switch (dcache_lookup (dir_sector, name, &sector))
+    {
+    case DCACHE_HIT:
+      *inode = inode_open (sector);
+      return *inode != NULL;
+    case DCACHE_NEGATIVE:
+      *inode = NULL;
+      return false;
+    case DCACHE_MISS:
+      break;
+    }
+
+  if (lookup (dir, name, &e, NULL, &complete))
+    {
+      dcache_insert (dir_sector, name, e.inode_sector);
+      *inode = inode_open (e.inode_sector);
+    }
   else
-    *inode = NULL;
+    {
+      /* Only remember NAME as absent if nothing went wrong while
+         looking for it. */
+      if (complete)
+        dcache_insert_negative (dir_sector, name);
+      *inode = NULL;
+    }
   //printf("inode %p\n",*inode);
   return *inode != NULL;
 }
@@ -145,8 +277,10 @@ bool
 dir_add (struct dir *dir, const char *name, block_sector_t inode_sector)
 {
   //printf("dir add\n");
+  struct dir_hash_header h;
   struct dir_entry e;
-  off_t ofs;
+  off_t ofs, free_ofs = -1;
+  size_t entry_cnt = 0;
   bool success = false;
 
   ASSERT (dir != NULL);
@@ -156,11 +290,19 @@ dir_add (struct dir *dir, const char *name, block_sector_t inode_sector)
   if (*name == '\0' || strlen (name) > NAME_MAX)
     return false;
 
-  /* Check that NAME is not in use. */
-  if (lookup (dir, name, NULL, NULL))
-    goto done;
+  if (read_hash_header (dir, &h))
+    {
+      if (lookup (dir, name, NULL, NULL, NULL))
+        goto done;
+      e.in_use = true;
+      strlcpy (e.name, name, sizeof e.name);
+      e.inode_sector = inode_sector;
+      success = hashed_add (dir, &h, &e);
+      goto done;
+    }
 
-  /* Set OFS to offset of free slot.
+  /* In a single pass, check that NAME is not in use, count the
+     entries, and set OFS to the offset of the first free slot.
      If there are no free slots, then it will be set to the
      current end-of-file.
 
@@ -170,15 +312,36 @@ dir_add (struct dir *dir, const char *name, block_sector_t inode_sector)
   for (ofs = 0; inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
        ofs += sizeof e)
     if (!e.in_use)
-      break;
+      {
+        if (free_ofs < 0)
+          free_ofs = ofs;
+      }
+    else if (!strcmp (name, e.name))
+      goto done;
+    else
+      entry_cnt++;
+  if (free_ofs >= 0)
+    ofs = free_ofs;
 
   /* Write slot. */
   e.in_use = true;
   strlcpy (e.name, name, sizeof e.name);
   e.inode_sector = inode_sector;
+
+  /* Switch big directories over to the hashed format.  "." and
+     ".." are not counted: they stay where they are. */
+  if (entry_cnt >= DIR_HASH_THRESHOLD + 2)
+    {
+      if (!rehash (dir, NULL, entry_cnt - 2) || !read_hash_header (dir, &h))
+        goto done;
+      success = hashed_add (dir, &h, &e);
+      goto done;
+    }
   success = inode_write_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
   //printf("dir pos %d success %d\n",dir->pos,success);
  done:
+  if (success)
+    dcache_insert (inode_get_inumber (dir->inode), name, inode_sector);
   return success;
 }
 
@@ -198,7 +361,7 @@ dir_remove (struct dir *dir, const char *name)
   ASSERT (name != NULL);
 
   /* Find directory entry. */
-  if (!lookup (dir, name, &e, &ofs))
+  if (!lookup (dir, name, &e, &ofs, NULL))
     goto done;
 
   //don't allow it to close its cwd
@@ -226,7 +389,16 @@ dir_remove (struct dir *dir, const char *name)
     goto done;
   }
 
+  /* Keep a hashed directory's entry count current. */
+  struct dir_hash_header h;
+  if (ofs >= (off_t) BLOCK_SECTOR_SIZE && read_hash_header (dir, &h))
+    {
+      h.entry_cnt--;
+      write_hash_header (dir, &h);
+    }
+
   /* Remove inode. */
+  dcache_invalidate (inode_get_inumber (dir->inode), name);
   inode_remove (inode);
 
   success = true;
@@ -250,8 +422,27 @@ dir_readdir (struct dir *dir, char name[NAME_MAX + 1])
     printf("e.name is %s, at pos %d and is in use %d\n", e.name, ofs, e.in_use);
   }*/
 
-  while (inode_read_at (dir->inode, &e, sizeof e, dir->pos) == sizeof e)
+  struct dir_hash_header h;
+  bool hashed = read_hash_header (dir, &h);
+  off_t end = hashed ? bucket_ofs (h.bucket_cnt) : 0;
+
+  for (;;)
     {
+      if (hashed)
+        {
+          /* Visit only the bucket slots: skip the rest of
+             sector 0 and each bucket's trailer. */
+          off_t slot = dir->pos % BLOCK_SECTOR_SIZE / sizeof e;
+          if (dir->pos < (off_t) BLOCK_SECTOR_SIZE
+              || slot >= (off_t) DIR_SLOTS_PER_BLOCK
+              || dir->pos % BLOCK_SECTOR_SIZE % sizeof e != 0)
+            dir->pos = ROUND_UP (dir->pos + 1, BLOCK_SECTOR_SIZE);
+          if (dir->pos >= end)
+            return false;
+        }
+      if (inode_read_at (dir->inode, &e, sizeof e, dir->pos) != sizeof e)
+        return false;
+
       //printf("(in while loop)e.name is %s, at pos %d and is in use %d\n", e.name, dir->pos, e.in_use);
       dir->pos += sizeof e;
       if (e.in_use)
@@ -260,5 +451,249 @@ dir_readdir (struct dir *dir, char name[NAME_MAX + 1])
           return true;
         }
     }
-  return false;
+}
+
+/* Reads DIR's hashed-format header into *H.
+   Returns true if DIR is in the hashed format, false if it is a
+   linear directory. */
+static bool
+read_hash_header (const struct dir *dir, struct dir_hash_header *h)
+{
+  ASSERT (sizeof *h == sizeof (struct dir_entry));
+
+  return (inode_read_at (dir->inode, h, sizeof *h, DIR_HASH_HEADER_OFS)
+          == sizeof *h
+          && h->magic == DIR_HASH_MAGIC
+          && !h->in_use
+          && h->bucket_cnt > 0);
+}
+
+/* Writes H as DIR's hashed-format header.
+   Returns true if successful, false on failure. */
+static bool
+write_hash_header (struct dir *dir, const struct dir_hash_header *h)
+{
+  return (inode_write_at (dir->inode, h, sizeof *h, DIR_HASH_HEADER_OFS)
+          == sizeof *h);
+}
+
+/* Returns the bucket in which NAME would be placed, in a hashed
+   directory with header H. */
+static size_t
+home_bucket (const struct dir_hash_header *h, const char *name)
+{
+  return hash_string (name) % h->bucket_cnt;
+}
+
+/* Returns the byte offset of BUCKET's block. */
+static off_t
+bucket_ofs (size_t bucket)
+{
+  return (bucket + 1) * BLOCK_SECTOR_SIZE;
+}
+
+/* Searches the buckets of hashed directory DIR, with header H,
+   for NAME.  Same interface as lookup(), except that *COMPLETEP
+   is only ever cleared. */
+static bool
+hashed_lookup (const struct dir *dir, const struct dir_hash_header *h,
+               const char *name, struct dir_entry *ep, off_t *ofsp,
+               bool *completep)
+{
+  struct dir_block *b;
+  size_t bucket = home_bucket (h, name);
+  size_t probe, i;
+  bool found = false;
+
+  b = malloc (sizeof *b);
+  if (b == NULL)
+    {
+      if (completep != NULL)
+        *completep = false;
+      return false;
+    }
+
+  for (probe = 0; probe < h->bucket_cnt && !found; probe++)
+    {
+      if (inode_read_at (dir->inode, b, sizeof *b, bucket_ofs (bucket))
+          != sizeof *b)
+        {
+          if (completep != NULL)
+            *completep = false;
+          break;
+        }
+      for (i = 0; i < DIR_SLOTS_PER_BLOCK; i++)
+        if (b->entries[i].in_use && !strcmp (name, b->entries[i].name))
+          {
+            if (ep != NULL)
+              *ep = b->entries[i];
+            if (ofsp != NULL)
+              *ofsp = bucket_ofs (bucket) + i * sizeof *b->entries;
+            found = true;
+            break;
+          }
+      if (!b->overflow)
+        break;
+      bucket = (bucket + 1) % h->bucket_cnt;
+    }
+
+  free (b);
+  return found;
+}
+
+/* Stores E in the first free slot at or after its home bucket
+   in hashed directory DIR, with header H, flagging each full
+   bucket it probes past.  Does not update the header.
+   Returns true if successful, false on failure. */
+static bool
+hashed_insert (struct dir *dir, const struct dir_hash_header *h,
+               const struct dir_entry *e)
+{
+  struct dir_block *b;
+  size_t bucket = home_bucket (h, e->name);
+  size_t probe, i;
+  bool success = false;
+
+  b = malloc (sizeof *b);
+  if (b == NULL)
+    return false;
+
+  for (probe = 0; probe < h->bucket_cnt; probe++)
+    {
+      off_t ofs = bucket_ofs (bucket);
+      if (inode_read_at (dir->inode, b, sizeof *b, ofs) != sizeof *b)
+        break;
+      for (i = 0; i < DIR_SLOTS_PER_BLOCK; i++)
+        if (!b->entries[i].in_use)
+          break;
+      if (i < DIR_SLOTS_PER_BLOCK)
+        {
+          ofs += i * sizeof *b->entries;
+          success = (inode_write_at (dir->inode, e, sizeof *e, ofs)
+                     == sizeof *e);
+          break;
+        }
+
+      /* Bucket is full: note that we moved on. */
+      if (!b->overflow)
+        {
+          b->overflow = 1;
+          if (inode_write_at (dir->inode, b, sizeof *b, ofs) != sizeof *b)
+            break;
+        }
+      bucket = (bucket + 1) % h->bucket_cnt;
+    }
+
+  free (b);
+  return success;
+}
+
+/* Adds E to hashed directory DIR, with header H, which must not
+   already contain E's name.  Doubles the number of buckets first
+   if the table would become more than 3/4 full.
+   Returns true if successful, false on failure. */
+static bool
+hashed_add (struct dir *dir, struct dir_hash_header *h,
+            const struct dir_entry *e)
+{
+  if ((h->entry_cnt + 1) * 4 > h->bucket_cnt * DIR_SLOTS_PER_BLOCK * 3)
+    {
+      if (!rehash (dir, h, h->entry_cnt) || !read_hash_header (dir, h))
+        return false;
+    }
+  if (!hashed_insert (dir, h, e))
+    return false;
+  h->entry_cnt++;
+  return write_hash_header (dir, h);
+}
+
+/* Rewrites DIR in the hashed format, sized for twice its
+   ENTRY_CNT entries (not counting "." and "..").  OLD is DIR's
+   current header, or a null pointer if DIR is still linear.
+   Returns true if successful, false on failure.
+
+   The new buckets overwrite the old layout, so DIR is first
+   grown to its final size, the step that fails if the disk is
+   full.  If it fails, DIR is left as it was.  The header is
+   written last. */
+static bool
+rehash (struct dir *dir, const struct dir_hash_header *old, size_t entry_cnt)
+{
+  struct dir_entry *entries;
+  struct dir_hash_header h;
+  struct dir_block *b;
+  size_t cnt = 0, i;
+  off_t ofs;
+  bool success = false;
+
+  entries = malloc ((entry_cnt + 1) * sizeof *entries);
+  b = calloc (1, sizeof *b);
+  if (entries == NULL || b == NULL)
+    goto done;
+
+  /* Gather every entry except "." and "..". */
+  if (old == NULL)
+    {
+      struct dir_entry e;
+      for (ofs = DIR_HASH_HEADER_OFS;
+           inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
+           ofs += sizeof e)
+        if (e.in_use && cnt < entry_cnt)
+          entries[cnt++] = e;
+    }
+  else
+    {
+      size_t bucket;
+      for (bucket = 0; bucket < old->bucket_cnt; bucket++)
+        {
+          if (inode_read_at (dir->inode, b, sizeof *b, bucket_ofs (bucket))
+              != sizeof *b)
+            goto done;
+          for (i = 0; i < DIR_SLOTS_PER_BLOCK; i++)
+            if (b->entries[i].in_use && cnt < entry_cnt)
+              entries[cnt++] = b->entries[i];
+        }
+      memset (b, 0, sizeof *b);
+    }
+
+  memset (&h, 0, sizeof h);
+  h.magic = DIR_HASH_MAGIC;
+  h.bucket_cnt = DIV_ROUND_UP (cnt * 2, DIR_SLOTS_PER_BLOCK);
+  if (h.bucket_cnt < DIR_MIN_BUCKETS)
+    h.bucket_cnt = DIR_MIN_BUCKETS;
+  h.entry_cnt = cnt;
+  h.in_use = false;
+
+  /* Grow DIR by writing its last new bucket, if that lies past
+     the current end of file, before touching any old data. */
+  ofs = bucket_ofs (h.bucket_cnt - 1);
+  if (ofs >= inode_length (dir->inode)
+      && inode_write_at (dir->inode, b, sizeof *b, ofs) != sizeof *b)
+    goto done;
+
+  /* Lay out empty buckets and reinsert. */
+  for (i = 0; i < h.bucket_cnt; i++)
+    if (inode_write_at (dir->inode, b, sizeof *b, bucket_ofs (i))
+        != sizeof *b)
+      goto done;
+  for (i = 0; i < cnt; i++)
+    if (!hashed_insert (dir, &h, &entries[i]))
+      goto done;
+
+  /* Clear the rest of sector 0 so stale linear entries vanish,
+     then switch over to the new buckets. */
+  for (ofs = DIR_HASH_HEADER_OFS + sizeof h;
+       ofs + (off_t) sizeof *entries <= (off_t) BLOCK_SECTOR_SIZE;
+       ofs += sizeof *entries)
+    if (inode_write_at (dir->inode, &b->entries[0], sizeof *entries, ofs)
+        != sizeof *entries)
+      goto done;
+  if (!write_hash_header (dir, &h))
+    goto done;
+  success = true;
+
+ done:
+  free (entries);
+  free (b);
+  return success;
 }
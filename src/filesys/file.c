@@ -1,7 +1,9 @@
 #include "filesys/file.h"
 #include <debug.h>
+#include "filesys/directory.h"
 #include "filesys/inode.h"
 #include "threads/malloc.h"
+#include "threads/slab.h"
 
 /* An open file. */
 struct file
@@ -11,13 +13,29 @@ struct file
     bool deny_write;            /* Has file_deny_write() been called? */
   };
 
+/* Cache of open files.  filesys_open() returns directories as
+   files, so `struct dir' is laid out like `struct file' and
+   either may be closed through the other's close function.
+   Both are therefore allocated from this one cache. */
+struct kmem_cache *file_cache;
+
+/* Initializes the open file cache. */
+void
+file_init (void) 
+{
+  size_t size = sizeof (struct file);
+  if (sizeof (struct dir) > size)
+    size = sizeof (struct dir);
+  file_cache = kmem_cache_create ("file", size, NULL);
+}
+
 /* Opens a file for the given INODE, of which it takes ownership,
    and returns the new file.  Returns a null pointer if an
    allocation fails or if INODE is null. */
 struct file *
 file_open (struct inode *inode)
 {
-  struct file *file = calloc (1, sizeof *file);
+  struct file *file = kmem_cache_alloc (file_cache);
   if (inode != NULL && file != NULL)
     {
       file->inode = inode;
@@ -28,7 +46,7 @@ file_open (struct inode *inode)
   else
     {
       inode_close (inode);
-      free (file);
+      kmem_cache_free (file_cache, file);
       return NULL;
     }
 }
@@ -64,7 +82,7 @@ file_close (struct file *file)
     {
       file_allow_write (file);
       inode_close (file->inode);
-      free (file);
+      kmem_cache_free (file_cache, file);
     }
 }
 
@@ -5,6 +5,11 @@
 
 struct inode;
 
+/* Cache that open files and directories are allocated from. */
+extern struct kmem_cache *file_cache;
+
+void file_init (void);
+
 /* Opening and closing files. */
 struct file *file_open (struct inode *);
 struct file *file_reopen (struct file *);
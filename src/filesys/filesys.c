@@ -3,6 +3,7 @@
 #include <stdio.h>
 #include <string.h>
 #include "filesys/cache.h"
+#include "filesys/dcache.h"
 #include "filesys/file.h"
 #include "filesys/free-map.h"
 #include "filesys/inode.h"
@@ -25,7 +26,9 @@ filesys_init (bool format)
     PANIC ("No file system device found, can't initialize file system.");
 
   inode_init ();
+  file_init ();
   cache_init ();
+  dcache_init ();
   free_map_init ();
   if (format)
     do_format ();
@@ -1,14 +1,16 @@
 #include "filesys/inode.h"
 #include <bitmap.h>
-#include <list.h>
+#include <hash.h>
 #include <debug.h>
 #include <round.h>
 #include <stdio.h>
 #include <string.h>
 #include "filesys/cache.h"
+#include "filesys/dcache.h"
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
 #include "threads/malloc.h"
+#include "threads/slab.h"
 #include "threads/synch.h"
 
 
@@ -20,6 +22,10 @@
 #define DBL_INDIRECT_CNT 1
 #define SECTOR_CNT (DIRECT_CNT + INDIRECT_CNT + DBL_INDIRECT_CNT)
 
+/* Most block mappings inode_read_at() and inode_write_at()
+   resolve with a single lookup. */
+#define SECTOR_BATCH 16
+
 #define PTRS_PER_SECTOR ((off_t) (BLOCK_SECTOR_SIZE / sizeof (block_sector_t)))
 #define INODE_SPAN ((DIRECT_CNT                                              \
                      + PTRS_PER_SECTOR * INDIRECT_CNT                        \
@@ -47,32 +53,79 @@ bytes_to_sectors (off_t size)
 /* In-memory inode. */
 struct inode
   {
-    struct list_elem elem;              /* Element in inode list. */
+    struct hash_elem elem;              /* Element in open_inodes. */
     block_sector_t sector;              /* Sector number of disk location. */
     int open_cnt;                       /* Number of openers. */
     bool removed;                       /* True if deleted, false otherwise. */
-    struct lock lock;
+    struct lock lock;                   /* Protects open_cnt. */
+
+    /* Copies of inode_disk fields, so that the common accessors
+       need not go through the buffer cache.  Kept in sync by
+       every function that changes the on-disk value. */
+    off_t length;                       /* File size in bytes. */
+    enum inode_type type;               /* FILE_INODE or DIR_INODE. */
 
     /* Denying writes. */
     int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
   };
 
-/* List of open inodes, so that opening a single inode twice
-   returns the same `struct inode'. */
-static struct list open_inodes;
+/* Open inodes, keyed on sector, so that opening a single inode
+   twice returns the same `struct inode'. */
+static struct hash open_inodes;
 
-/* Controls access to open_inodes list. */
-static struct lock open_inodes_lock;
+/* Cache of `struct inode'. */
+static struct kmem_cache *inode_cache;
+
+/* Controls access to open_inodes.  Opening an inode that is
+   already open, by far the common case, only reads the table, so
+   it takes this lock for reading.  Each inode's open_cnt is
+   protected by the inode's own lock, but changing it to or from
+   zero also requires holding this lock for writing, so that an
+   inode found in the table is never one that is being freed. */
+static struct rwlock open_inodes_lock;
 
 static void deallocate_inode (const struct inode *);
 static bool allocate_sectors(struct inode_disk *, off_t , off_t );
+static hash_hash_func inode_hash;
+static hash_less_func inode_less;
+static kmem_ctor_func inode_ctor;
 
 /* Initializes the inode module. */
 void
 inode_init (void)
 {
-  list_init (&open_inodes);
-  lock_init (&open_inodes_lock);
+  hash_init (&open_inodes, inode_hash, inode_less, NULL);
+  rwlock_init (&open_inodes_lock);
+  rwlock_set_name (&open_inodes_lock, "open_inodes_lock");
+  inode_cache = kmem_cache_create ("inode", sizeof (struct inode),
+                                   inode_ctor);
+}
+
+/* Constructs the parts of a cached inode that survive being
+   freed: its lock, which is free whenever the inode is closed. */
+static void
+inode_ctor (void *inode_)
+{
+  struct inode *inode = inode_;
+  lock_init (&inode->lock);
+  lock_set_name (&inode->lock, "inode");
+}
+
+/* Returns a hash value for the inode containing E. */
+static unsigned
+inode_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  return hash_int (hash_entry (e, struct inode, elem)->sector);
+}
+
+/* Returns true if the inode containing A precedes the one
+   containing B. */
+static bool
+inode_less (const struct hash_elem *a, const struct hash_elem *b,
+            void *aux UNUSED)
+{
+  return (hash_entry (a, struct inode, elem)->sector
+          < hash_entry (b, struct inode, elem)->sector);
 }
 
 /* Returns the block device sector that contains byte offset POS
@@ -178,34 +231,57 @@ inode_create (block_sector_t sector, off_t length, enum inode_type type)
 struct inode *
 inode_open (block_sector_t sector)
 {
-  struct list_elem *e;
+  struct hash_elem *e;
   struct inode *inode;
+  struct inode_disk *id;
+  struct inode key;
 
   /* Check whether this inode is already open. */
-  for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
-       e = list_next (e))
+  key.sector = sector;
+  rwlock_acquire_read (&open_inodes_lock);
+  e = hash_find (&open_inodes, &key.elem);
+  if (e != NULL)
     {
-      inode = list_entry (e, struct inode, elem);
-      if (inode->sector == sector)
-        {
-          inode_reopen (inode);
-          return inode;
-        }
+      inode = hash_entry (e, struct inode, elem);
+      lock_acquire_adaptive (&inode->lock);
+      inode->open_cnt++;
+      lock_release (&inode->lock);
+      rwlock_release_read (&open_inodes_lock);
+      return inode;
+    }
+  rwlock_release_read (&open_inodes_lock);
+
+  /* Not open.  Check again, since another thread may have opened
+     it while we held no lock. */
+  rwlock_acquire_write (&open_inodes_lock);
+  e = hash_find (&open_inodes, &key.elem);
+  if (e != NULL)
+    {
+      inode = hash_entry (e, struct inode, elem);
+      lock_acquire_adaptive (&inode->lock);
+      inode->open_cnt++;
+      lock_release (&inode->lock);
+      rwlock_release_write (&open_inodes_lock);
+      return inode;
     }
 
   /* Allocate memory. */
-  inode = malloc (sizeof *inode);
+  inode = kmem_cache_alloc (inode_cache);
   if (inode == NULL){
+    rwlock_release_write (&open_inodes_lock);
     return NULL;
   }
 
   /* Initialize. */
-  list_push_front (&open_inodes, &inode->elem);
   inode->sector = sector;
   inode->open_cnt = 1;
   inode->deny_write_cnt = 0;
   inode->removed = false;
-  lock_init(&inode->lock);
+  id = (struct inode_disk *) cache_read (sector)->data;
+  inode->length = id->length;
+  inode->type = id->type;
+  hash_insert (&open_inodes, &inode->elem);
+  rwlock_release_write (&open_inodes_lock);
   return inode;
 }
 
@@ -215,9 +291,10 @@ inode_reopen (struct inode *inode)
 {
   if (inode != NULL)
     {
-      lock_acquire (&open_inodes_lock);
+      /* The caller's reference keeps open_cnt above zero. */
+      lock_acquire_adaptive (&inode->lock);
       inode->open_cnt++;
-      lock_release (&open_inodes_lock);
+      lock_release (&inode->lock);
     }
   return inode;
 }
@@ -226,10 +303,7 @@ inode_reopen (struct inode *inode)
 enum inode_type
 inode_get_type (const struct inode *inode)
 {
-  struct cache_block *b = cache_read(inode->sector);
-  struct inode_disk *id = (struct inode_disk *)(b->data);
-  enum inode_type type = id->type;
-  return type;
+  return inode->type;
 }
 
 /* Returns INODE's inode number. */
@@ -249,20 +323,40 @@ inode_close (struct inode *inode)
   if (inode == NULL)
     return;
   cache_flush();
-  /* Release resources if this was the last opener. */
-  if (--inode->open_cnt == 0)
+  /* If other openers remain, just drop our reference. */
+  lock_acquire_adaptive (&inode->lock);
+  if (inode->open_cnt > 1)
     {
-      /* Remove from inode list and release lock. */
-      list_remove (&inode->elem);
+      inode->open_cnt--;
+      lock_release (&inode->lock);
+      return;
+    }
+  lock_release (&inode->lock);
 
-      /* Deallocate blocks if removed. */
-      if (inode->removed)
-        {
-          deallocate_inode(inode);
-        }
+  /* We may be the last opener.  Exclude inode_open() and check
+     again, since inode_reopen() may have added a reference. */
+  rwlock_acquire_write (&open_inodes_lock);
+  lock_acquire_adaptive (&inode->lock);
+  if (--inode->open_cnt > 0)
+    {
+      lock_release (&inode->lock);
+      rwlock_release_write (&open_inodes_lock);
+      return;
+    }
+  lock_release (&inode->lock);
+
+  /* Remove from inode table and release lock. */
+  hash_delete (&open_inodes, &inode->elem);
+  rwlock_release_write (&open_inodes_lock);
 
-      free (inode);
+  /* Deallocate blocks if removed. */
+  if (inode->removed)
+    {
+      dcache_purge_dir (inode->sector);
+      deallocate_inode(inode);
     }
+
+  kmem_cache_free (inode_cache, inode);
 }
 
 /* Deallocates SECTOR and anything it points to recursively.
@@ -512,7 +606,7 @@ get_data_block (struct inode *inode, off_t offset, bool allocate,
     else{
       if (!allocate_sectors(id,existing_sectors,new_sectors))
         return false;
-      id->length = offset;
+      id->length = inode->length = offset;
     }
   }
   size_t offsets[3];
@@ -533,54 +627,102 @@ get_data_block (struct inode *inode, off_t offset, bool allocate,
   return true;
 }
 
+/* Stores in SECTORS the device sectors of up to CNT consecutive
+   blocks of INODE, starting with block SECTOR_IDX, and returns
+   the number stored.  Only direct blocks inside the file are
+   mapped this way; returns 0 if block SECTOR_IDX is an indirect
+   block or lies past the end of INODE. */
+static size_t
+map_direct_sectors (const struct inode *inode, off_t sector_idx, size_t cnt,
+                    block_sector_t sectors[])
+{
+  off_t end = bytes_to_sectors (inode->length);
+  const struct inode_disk *id;
+
+  ASSERT (sector_idx >= 0);
+
+  if (end > DIRECT_CNT)
+    end = DIRECT_CNT;
+  if (sector_idx >= end)
+    return 0;
+  if (cnt > (size_t) (end - sector_idx))
+    cnt = end - sector_idx;
+
+  /* Copy the mappings out: later cache_read()s may evict the
+     inode's own block. */
+  id = (const struct inode_disk *) cache_read (inode->sector)->data;
+  memcpy (sectors, &id->sectors[sector_idx], cnt * sizeof *sectors);
+  return cnt;
+}
+
+/* Returns the number of blocks, at most SECTOR_BATCH, that a
+   transfer of SIZE bytes starting at OFFSET touches. */
+static size_t
+span_sectors (off_t size, off_t offset)
+{
+  size_t cnt = DIV_ROUND_UP (offset % BLOCK_SECTOR_SIZE + size,
+                             BLOCK_SECTOR_SIZE);
+  return cnt < SECTOR_BATCH ? cnt : SECTOR_BATCH;
+}
+
 /* Reads SIZE bytes from INODE into BUFFER, starting at position OFFSET.
    Returns the number of bytes actually read, which may be less
-   than SIZE if an error occurs or end of file is reached. */
+   than SIZE if an error occurs or end of file is reached.
+   Reads nothing if OFFSET is negative. */
 off_t
 inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
 {
   uint8_t *buffer = buffer_;
   off_t bytes_read = 0;
-  struct cache_block * read_block;
-  int i;
+  block_sector_t sectors[SECTOR_BATCH];
+
+  if (offset < 0)
+    return 0;
+
   while (size > 0)
     {
-      /* Disk sector to read, starting byte offset within sector. */
-      //block_sector_t sector_idx = byte_to_sector(inode, offset);
-      int sector_ofs = offset % BLOCK_SECTOR_SIZE;
-
+      struct cache_block *read_block;
+      size_t cnt, i;
+
+      /* Resolve a run of direct blocks with one mapping lookup,
+         then copy each one out whole. */
+      cnt = map_direct_sectors (inode, offset / BLOCK_SECTOR_SIZE,
+                                span_sectors (size, offset), sectors);
+      for (i = 0; i < cnt; i++)
+        {
+          int sector_ofs = offset % BLOCK_SECTOR_SIZE;
+          int sector_left = BLOCK_SECTOR_SIZE - sector_ofs;
+          int chunk_size = size < sector_left ? size : sector_left;
+
+          read_block = cache_read (sectors[i]);
+          memcpy (buffer + bytes_read, read_block->data + sector_ofs,
+                  chunk_size);
+          bytes_read += chunk_size;
+          size -= chunk_size;
+          offset += chunk_size;
+        }
+      if (cnt > 0)
+        continue;
 
-      /* Bytes left in inode, bytes left in sector, lesser of the two. */
-      off_t inode_left = inode_length (inode) - offset;
+      /* Indirect block, or past the end of the file. */
+      int sector_ofs = offset % BLOCK_SECTOR_SIZE;
       int sector_left = BLOCK_SECTOR_SIZE - sector_ofs;
-      //int min_left = inode_left < sector_left ? inode_left : sector_left;
-      int min_left = sector_left;
-
-      /* Number of bytes to actually copy out of this sector. */
-      int chunk_size = size < min_left ? size : min_left;
-      if (chunk_size <= 0 || !get_data_block (inode, offset, false, &read_block))
+      int chunk_size = size < sector_left ? size : sector_left;
+      if (!get_data_block (inode, offset, false, &read_block))
         break;
 
-      //read_block = cache_read(sector_idx);
       //remeber that allocate is false, so *read_block will always be NULL
       //in the even of read that is past the point of the file
       //we always just have them read 0 into the buffer, check the provided inode_read_at
       //it displays this behavior
       if (read_block == NULL)
-        memset (buffer + bytes_read, 0, chunk_size);
-      else
-      {
-        i = sector_ofs;
-        for (int n = chunk_size; n>0; n--)
         {
-          //printf("read %c\n",read_block->data[i]);
-          buffer[bytes_read] = read_block->data[i];
-          bytes_read++;
-          i++;
+          /* Every later block is past the end too. */
+          memset (buffer + bytes_read, 0, size);
+          break;
         }
-      }
-
-      /* Advance. */
+      memcpy (buffer + bytes_read, read_block->data + sector_ofs, chunk_size);
+      bytes_read += chunk_size;
       size -= chunk_size;
       offset += chunk_size;
     }
@@ -594,7 +736,7 @@ extend_file (struct inode *inode, off_t length)
   struct cache_block * inode_cache = cache_read(inode->sector);
   struct inode_disk *id = inode_cache->data;
   if (length > id->length)
-    id->length = length;
+    id->length = inode->length = length;
   //printf("inode length %d\n",id->length);
 }
 
@@ -602,50 +744,57 @@ extend_file (struct inode *inode, off_t length)
    Returns the number of bytes actually written, which may be
    less than SIZE if end of file is reached or an error occurs.
    (Normally a write at end of file would extend the inode, but
-   growth is not yet implemented.) */
+   growth is not yet implemented.)  Writes nothing if OFFSET is
+   negative. */
 off_t
 inode_write_at (struct inode *inode, const void *buffer_, off_t size,
                 off_t offset)
 {
   off_t bytes_written = 0;
   const uint8_t *buffer = buffer_;
-  struct cache_block * write_block;
-  int i;
+  block_sector_t sectors[SECTOR_BATCH];
 
-  if (inode->deny_write_cnt)
+  if (inode->deny_write_cnt || offset < 0)
     return 0;
   //printf("writing %s\n",buffer);
 
   while (size > 0)
     {
-      /* Disk sector to read, starting byte offset within sector. */
-      //block_sector_t sector_idx = byte_to_sector(inode, offset);
-      //printf("sector is %d\n", sector_idx);
-      int sector_ofs = offset % BLOCK_SECTOR_SIZE;
+      struct cache_block *write_block;
+      size_t cnt, i;
+
+      /* Resolve a run of existing direct blocks with one mapping
+         lookup, then copy each one in whole. */
+      cnt = map_direct_sectors (inode, offset / BLOCK_SECTOR_SIZE,
+                                span_sectors (size, offset), sectors);
+      for (i = 0; i < cnt; i++)
+        {
+          int sector_ofs = offset % BLOCK_SECTOR_SIZE;
+          int sector_left = BLOCK_SECTOR_SIZE - sector_ofs;
+          int chunk_size = size < sector_left ? size : sector_left;
+
+          write_block = cache_read (sectors[i]);
+          memcpy (write_block->data + sector_ofs, buffer + bytes_written,
+                  chunk_size);
+          write_block->dirty = true;
+          bytes_written += chunk_size;
+          size -= chunk_size;
+          offset += chunk_size;
+        }
+      if (cnt > 0)
+        continue;
 
-      /* Bytes left in inode, bytes left in sector, lesser of the two. */
-      off_t inode_left = inode_length (inode) - offset;
+      /* Indirect block, or a block that must be allocated. */
+      int sector_ofs = offset % BLOCK_SECTOR_SIZE;
       int sector_left = BLOCK_SECTOR_SIZE - sector_ofs;
-      //int min_left = inode_left < sector_left ? inode_left : sector_left;
-      int min_left = sector_left;
-
-      /* Number of bytes to actually write into this sector. */
-      int chunk_size = size < min_left ? size : min_left;
-      if (chunk_size <= 0 || !get_data_block (inode, offset, true, &write_block))
+      int chunk_size = size < sector_left ? size : sector_left;
+      if (!get_data_block (inode, offset, true, &write_block))
         break;
 
-      i = sector_ofs;
-      for (int n = chunk_size; n>0; n--)
-      {
-        write_block->data[i] = buffer[bytes_written];
-        bytes_written++;
-        i++;
-      }
-      write_block->dirty=true;
-
-      //printf("\t%s\n",write_block->data );
-
-      /* Advance. */
+      memcpy (write_block->data + sector_ofs, buffer + bytes_written,
+              chunk_size);
+      write_block->dirty = true;
+      bytes_written += chunk_size;
       size -= chunk_size;
       offset += chunk_size;
     }
@@ -677,22 +826,15 @@ inode_allow_write (struct inode *inode)
 off_t
 inode_length (const struct inode *inode)
 {
-  struct cache_block * inode_cache = cache_read(inode->sector);
-  struct inode_disk *id = inode_cache->data;
-  return id->length;
+  return inode->length;
 }
 
-/* Returns the number of openers. */
+/* Returns the number of openers.  The count may change as soon
+   as it is read, with or without a lock, so none is taken. */
 int
 inode_open_cnt (const struct inode *inode)
 {
-  int open_cnt;
-
-  lock_acquire (&open_inodes_lock);
-  open_cnt = inode->open_cnt;
-  lock_release (&open_inodes_lock);
-
-  return open_cnt;
+  return inode->open_cnt;
 }
 
 
@@ -0,0 +1,21 @@
+#ifndef __LIB_CACHESTAT_H
+#define __LIB_CACHESTAT_H
+
+#include <stdint.h>
+
+/* Buffer cache statistics, as reported by cache_stats().  Shared
+   by the kernel and user programs. */
+struct cache_stats
+  {
+    uint64_t hits;              /* Lookups that found the sector cached. */
+    uint64_t misses;            /* Lookups that had to read the sector. */
+    uint64_t probes;            /* Slots examined by all lookups. */
+    uint64_t evictions;         /* Blocks evicted to make room. */
+    uint64_t dirty_evictions;   /* Evicted blocks that were dirty. */
+    uint64_t hand_moves;        /* Clock hand advances while evicting. */
+    uint64_t flushes;           /* Calls to flush the whole cache. */
+    uint64_t flushed_blocks;    /* Dirty blocks written by flushes. */
+    uint32_t block_cnt;         /* Blocks in the cache. */
+  };
+
+#endif /* lib/cachestat.h */
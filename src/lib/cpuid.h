@@ -0,0 +1,73 @@
+#ifndef __LIB_CPUID_H
+#define __LIB_CPUID_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* CPUID feature detection, shared by the kernel and user
+   programs.  See [IA32-v2a] "CPUID". */
+
+/* EDX feature bits returned by CPUID leaf 1. */
+#define CPUID_TSC (1u << 4)             /* Time stamp counter. */
+#define CPUID_SEP (1u << 11)            /* SYSENTER and SYSEXIT. */
+
+/* Returns true if the CPU implements the CPUID instruction.
+   CPUID is itself optional on the i486, so check that the ID
+   bit (bit 21) of EFLAGS can be toggled. */
+static inline bool
+cpuid_present (void)
+{
+  uint32_t before, after;
+
+  asm volatile ("pushfl; popl %0; movl %0, %1; xorl %2, %1; "
+                "pushl %1; popfl; pushfl; popl %1; pushl %0; popfl"
+                : "=&r" (before), "=&r" (after) : "i" (1u << 21));
+  return ((before ^ after) & (1u << 21)) != 0;
+}
+
+/* Executes CPUID leaf LEAF and returns its EAX, EBX, ECX, and
+   EDX outputs in REGS[0] through REGS[3]. */
+static inline void
+cpuid (uint32_t leaf, uint32_t regs[4])
+{
+  asm volatile ("cpuid"
+                : "=a" (regs[0]), "=b" (regs[1]),
+                  "=c" (regs[2]), "=d" (regs[3])
+                : "a" (leaf));
+}
+
+/* Returns the EDX feature bits from CPUID leaf 1, or 0 if the
+   CPU has no CPUID instruction. */
+static inline uint32_t
+cpuid_features (void)
+{
+  uint32_t regs[4];
+
+  if (!cpuid_present ())
+    return 0;
+  cpuid (1, regs);
+  return regs[3];
+}
+
+/* Returns true if SYSENTER and SYSEXIT may be used.  Early
+   Pentium Pro parts (family 6, model < 3, stepping < 3) report
+   the SEP bit without actually supporting the instructions. */
+static inline bool
+cpuid_has_sysenter (void)
+{
+  uint32_t regs[4];
+  unsigned family, model, stepping;
+
+  if (!cpuid_present ())
+    return false;
+  cpuid (1, regs);
+  if ((regs[3] & CPUID_SEP) == 0)
+    return false;
+
+  family = (regs[0] >> 8) & 0xf;
+  model = (regs[0] >> 4) & 0xf;
+  stepping = regs[0] & 0xf;
+  return !(family == 6 && model < 3 && stepping < 3);
+}
+
+#endif /* lib/cpuid.h */
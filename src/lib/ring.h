@@ -0,0 +1,63 @@
+#ifndef __LIB_RING_H
+#define __LIB_RING_H
+
+#include <stdint.h>
+
+/* Batched system call ring.
+
+   A user program queues I/O requests in a `struct ring' in its
+   own memory, then passes the ring to the ring_enter() system
+   call, which carries out every queued request in one trap.
+
+   The program owns SQ_TAIL and CQ_HEAD; the kernel owns SQ_HEAD
+   and CQ_TAIL.  All four count up forever, and an index I refers
+   to slot I % RING_ENTRIES.  To submit a request, fill in
+   sqes[sq_tail % RING_ENTRIES] and increment SQ_TAIL.  The
+   kernel consumes submissions in order, posting one completion
+   per submission at cqes[cq_tail % RING_ENTRIES], and stops
+   early if the completion queue fills up.  The program then
+   reads completions from CQ_HEAD up to CQ_TAIL, advancing
+   CQ_HEAD as it goes. */
+
+/* Number of slots in each queue.  Must be a power of 2. */
+#define RING_ENTRIES 64
+
+/* Ring operations. */
+enum ring_op
+  {
+    RING_NOP,                   /* Do nothing; result is 0. */
+    RING_READ,                  /* read (fd, buf, len). */
+    RING_WRITE,                 /* write (fd, buf, len). */
+    RING_OPEN,                  /* open (buf); buf is a file name. */
+    RING_CLOSE                  /* close (fd); result is 0. */
+  };
+
+/* A submission queue entry. */
+struct ring_sqe
+  {
+    uint32_t op;                /* A `enum ring_op'. */
+    int32_t fd;                 /* File descriptor. */
+    void *buf;                  /* Data buffer or file name. */
+    uint32_t len;               /* Length of BUF in bytes. */
+    uint32_t user_data;         /* Copied to the completion. */
+  };
+
+/* A completion queue entry. */
+struct ring_cqe
+  {
+    uint32_t user_data;         /* From the submission. */
+    int32_t result;             /* What the equivalent call returned. */
+  };
+
+/* Submission and completion queues. */
+struct ring
+  {
+    uint32_t sq_head;           /* Next submission to consume. */
+    uint32_t sq_tail;           /* One past the last submission. */
+    uint32_t cq_head;           /* Next completion to reap. */
+    uint32_t cq_tail;           /* One past the last completion. */
+    struct ring_sqe sqes[RING_ENTRIES];
+    struct ring_cqe cqes[RING_ENTRIES];
+  };
+
+#endif /* lib/ring.h */
@@ -0,0 +1,24 @@
+#ifndef __LIB_RUSAGE_H
+#define __LIB_RUSAGE_H
+
+#include <stdint.h>
+
+/* Resource usage, as reported by getrusage().  Shared by the
+   kernel and user programs. */
+struct rusage
+  {
+    int64_t user_ticks;         /* Timer ticks spent in user mode. */
+    int64_t kernel_ticks;       /* Timer ticks spent in the kernel. */
+    int64_t io_wait_ns;         /* Nanoseconds waiting for disk I/O. */
+    uint64_t bytes_read;        /* Bytes read by system calls. */
+    uint64_t bytes_written;     /* Bytes written by system calls. */
+    uint32_t voluntary_switches;   /* Context switches while blocking. */
+    uint32_t involuntary_switches; /* Context switches by preemption. */
+    uint32_t page_faults;       /* Page faults. */
+  };
+
+/* Values for getrusage()'s WHO argument. */
+#define RUSAGE_SELF 0           /* The calling process. */
+#define RUSAGE_CHILDREN (-1)    /* Its children that have been waited for. */
+
+#endif /* lib/rusage.h */
@@ -28,7 +28,27 @@ enum
     SYS_MKDIR,                  /* Create a directory. */
     SYS_READDIR,                /* Reads a directory entry. */
     SYS_ISDIR,                  /* Tests if a fd represents a directory. */
-    SYS_INUMBER                 /* Returns the inode number for a fd. */
+    SYS_INUMBER,                /* Returns the inode number for a fd. */
+
+    /* Scheduler extensions. */
+    SYS_NICE,                   /* Adjust the process's nice value. */
+
+    /* Timing. */
+    SYS_CLOCK,                  /* Read the monotonic clock. */
+
+    /* Vectored and positional I/O. */
+    SYS_READV,                  /* Read into several buffers. */
+    SYS_WRITEV,                 /* Write from several buffers. */
+    SYS_PREAD,                  /* Read at a given offset. */
+    SYS_PWRITE,                 /* Write at a given offset. */
+
+    /* Batched I/O. */
+    SYS_RING_ENTER,             /* Run the requests queued in a ring. */
+
+    /* Instrumentation. */
+    SYS_LOCK_STATS,             /* Print lock contention statistics. */
+    SYS_GETRUSAGE,              /* Report resource usage. */
+    SYS_CACHE_STATS             /* Report buffer cache statistics. */
   };
 
 #endif /* lib/syscall-nr.h */
@@ -0,0 +1,17 @@
+#ifndef __LIB_UIO_H
+#define __LIB_UIO_H
+
+#include <stddef.h>
+
+/* One buffer in a scatter-gather transfer, as passed to readv()
+   and writev().  Shared by the kernel and user programs. */
+struct iovec
+  {
+    void *iov_base;             /* Start of buffer. */
+    size_t iov_len;             /* Length of buffer in bytes. */
+  };
+
+/* Maximum number of buffers in a single readv() or writev(). */
+#define IOV_MAX 32
+
+#endif /* lib/uio.h */
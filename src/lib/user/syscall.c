@@ -1,16 +1,63 @@
 #include <syscall.h>
+#include <cpuid.h>
 #include "../syscall-nr.h"
 
+/* System call entry stubs.
+
+   The syscallN() macros below push their arguments and the
+   system call number, then call through syscall_entry, which
+   points to one of these two stubs.  Either way the kernel
+   finds the system call number at the user stack pointer, just
+   as if "int $0x30" had been executed inline.
+
+   syscall_entry_int is the portable fallback: it pops the
+   return address, traps with "int $0x30", and jumps back.
+
+   syscall_entry_sysenter uses the much cheaper SYSENTER
+   instruction.  SYSENTER saves neither the user stack pointer
+   nor the return address, so the stub passes them to the kernel
+   in ECX and EDX, and the kernel's SYSEXIT returns straight to
+   the caller of the stub with the stack pointer restored. */
+void syscall_entry_int (void);
+void syscall_entry_sysenter (void);
+asm (".text\n"
+     ".globl syscall_entry_int\n"
+     "syscall_entry_int:\n"
+     "\tpopl %edx\n"
+     "\tint $0x30\n"
+     "\tjmp *%edx\n"
+     ".globl syscall_entry_sysenter\n"
+     "syscall_entry_sysenter:\n"
+     "\tpopl %edx\n"
+     "\tmovl %esp, %ecx\n"
+     "\tsysenter\n");
+
+/* Stub used by the syscallN() macros.  Starts out as the
+   fallback, so that system calls work even before
+   syscall_init() runs. */
+static void (*syscall_entry) (void) __attribute__ ((used))
+  = syscall_entry_int;
+
+/* Selects the fastest system call entry stub that this CPU
+   supports.  Called by _start() before main(). */
+void
+syscall_init (void) 
+{
+  if (cpuid_has_sysenter ())
+    syscall_entry = syscall_entry_sysenter;
+}
+
 /* Invokes syscall NUMBER, passing no arguments, and returns the
    return value as an `int'. */
 #define syscall0(NUMBER)                                        \
         ({                                                      \
           int retval;                                           \
           asm volatile                                          \
-            ("pushl %[number]; int $0x30; addl $4, %%esp"       \
+            ("pushl %[number]; "                                \
+             "call *syscall_entry; addl $4, %%esp"              \
                : "=a" (retval)                                  \
                : [number] "i" (NUMBER)                          \
-               : "memory");                                     \
+               : "ecx", "edx", "memory");                       \
           retval;                                               \
         })
 
@@ -20,11 +67,12 @@
         ({                                                               \
           int retval;                                                    \
           asm volatile                                                   \
-            ("pushl %[arg0]; pushl %[number]; int $0x30; addl $8, %%esp" \
+            ("pushl %[arg0]; pushl %[number]; "                          \
+             "call *syscall_entry; addl $8, %%esp"                       \
                : "=a" (retval)                                           \
                : [number] "i" (NUMBER),                                  \
                  [arg0] "g" (ARG0)                                       \
-               : "memory");                                              \
+               : "ecx", "edx", "memory");                                \
           retval;                                                        \
         })
 
@@ -35,12 +83,13 @@
           int retval;                                           \
           asm volatile                                          \
             ("pushl %[arg1]; pushl %[arg0]; "                   \
-             "pushl %[number]; int $0x30; addl $12, %%esp"      \
+             "pushl %[number]; "                                \
+             "call *syscall_entry; addl $12, %%esp"             \
                : "=a" (retval)                                  \
                : [number] "i" (NUMBER),                         \
                  [arg0] "r" (ARG0),                             \
                  [arg1] "r" (ARG1)                              \
-               : "memory");                                     \
+               : "ecx", "edx", "memory");                       \
           retval;                                               \
         })
 
@@ -51,13 +100,34 @@
           int retval;                                           \
           asm volatile                                          \
             ("pushl %[arg2]; pushl %[arg1]; pushl %[arg0]; "    \
-             "pushl %[number]; int $0x30; addl $16, %%esp"      \
+             "pushl %[number]; "                                \
+             "call *syscall_entry; addl $16, %%esp"             \
                : "=a" (retval)                                  \
                : [number] "i" (NUMBER),                         \
                  [arg0] "r" (ARG0),                             \
                  [arg1] "r" (ARG1),                             \
                  [arg2] "r" (ARG2)                              \
-               : "memory");                                     \
+               : "ecx", "edx", "memory");                       \
+          retval;                                               \
+        })
+
+/* Invokes syscall NUMBER, passing arguments ARG0, ARG1, ARG2,
+   and ARG3, and returns the return value as an `int'. */
+#define syscall4(NUMBER, ARG0, ARG1, ARG2, ARG3)                \
+        ({                                                      \
+          int retval;                                           \
+          asm volatile                                          \
+            ("pushl %[arg3]; pushl %[arg2]; "                   \
+             "pushl %[arg1]; pushl %[arg0]; "                   \
+             "pushl %[number]; "                                \
+             "call *syscall_entry; addl $20, %%esp"             \
+               : "=a" (retval)                                  \
+               : [number] "i" (NUMBER),                         \
+                 [arg0] "r" (ARG0),                             \
+                 [arg1] "r" (ARG1),                             \
+                 [arg2] "r" (ARG2),                             \
+                 [arg3] "r" (ARG3)                              \
+               : "ecx", "edx", "memory");                       \
           retval;                                               \
         })
 
@@ -182,3 +252,65 @@ inumber (int fd)
 {
   return syscall1 (SYS_INUMBER, fd);
 }
+
+int
+nice (int increment)
+{
+  return syscall1 (SYS_NICE, increment);
+}
+
+int64_t
+clock_ns (void)
+{
+  int64_t ns;
+  syscall1 (SYS_CLOCK, &ns);
+  return ns;
+}
+
+int
+readv (int fd, const struct iovec *iov, int iovcnt)
+{
+  return syscall3 (SYS_READV, fd, iov, iovcnt);
+}
+
+int
+writev (int fd, const struct iovec *iov, int iovcnt)
+{
+  return syscall3 (SYS_WRITEV, fd, iov, iovcnt);
+}
+
+int
+pread (int fd, void *buffer, unsigned size, unsigned offset)
+{
+  return syscall4 (SYS_PREAD, fd, buffer, size, offset);
+}
+
+int
+pwrite (int fd, const void *buffer, unsigned size, unsigned offset)
+{
+  return syscall4 (SYS_PWRITE, fd, buffer, size, offset);
+}
+
+int
+ring_enter (struct ring *ring)
+{
+  return syscall1 (SYS_RING_ENTER, ring);
+}
+
+void
+lock_stats (void)
+{
+  syscall0 (SYS_LOCK_STATS);
+}
+
+int
+getrusage (int who, struct rusage *usage)
+{
+  return syscall2 (SYS_GETRUSAGE, who, usage);
+}
+
+void
+cache_stats (struct cache_stats *stats)
+{
+  syscall1 (SYS_CACHE_STATS, stats);
+}
@@ -2,7 +2,12 @@
 #define __LIB_USER_SYSCALL_H
 
 #include <stdbool.h>
+#include <stdint.h>
+#include <cachestat.h>
 #include <debug.h>
+#include <ring.h>
+#include <rusage.h>
+#include <uio.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -19,6 +24,9 @@ typedef int mapid_t;
 #define EXIT_SUCCESS 0          /* Successful execution. */
 #define EXIT_FAILURE 1          /* Unsuccessful execution. */
 
+/* Called by _start() to pick the system call entry method. */
+void syscall_init (void);
+
 /* Projects 2 and later. */
 void halt (void) NO_RETURN;
 void exit (int status) NO_RETURN;
@@ -45,4 +53,24 @@ bool readdir (int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir (int fd);
 int inumber (int fd);
 
+/* Scheduler extensions. */
+int nice (int increment);
+
+/* Timing. */
+int64_t clock_ns (void);
+
+/* Vectored and positional I/O. */
+int readv (int fd, const struct iovec *iov, int iovcnt);
+int writev (int fd, const struct iovec *iov, int iovcnt);
+int pread (int fd, void *buffer, unsigned length, unsigned offset);
+int pwrite (int fd, const void *buffer, unsigned length, unsigned offset);
+
+/* Batched I/O. */
+int ring_enter (struct ring *);
+
+/* Instrumentation. */
+void lock_stats (void);
+int getrusage (int who, struct rusage *);
+void cache_stats (struct cache_stats *);
+
 #endif /* lib/user/syscall.h */
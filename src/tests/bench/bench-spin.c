@@ -0,0 +1,20 @@
+/* Child process run by the ctx-switch and exec-wait benchmarks.
+   Spins for the number of iterations given as its argument, so
+   that it stays runnable without making system calls, then
+   exits. */
+
+#include <stdlib.h>
+#include "tests/lib.h"
+
+const char *test_name = "bench-spin";
+
+int
+main (int argc, char *argv[])
+{
+  volatile unsigned sum = 0;
+  int i, iterations = argc > 1 ? atoi (argv[1]) : 0;
+
+  for (i = 0; i < iterations; i++)
+    sum += i;
+  return 0;
+}
@@ -0,0 +1,53 @@
+#include "tests/bench/bench.h"
+#include <syscall.h>
+#include "tests/lib.h"
+
+/* Returns a timestamp to pass to bench_elapsed(). */
+int64_t
+bench_start (void)
+{
+  return clock_ns ();
+}
+
+/* Returns the number of nanoseconds since START, which was
+   returned by bench_start(). */
+int64_t
+bench_elapsed (int64_t start)
+{
+  int64_t ns = clock_ns () - start;
+  return ns > 0 ? ns : 1;
+}
+
+/* Reports moving BYTES bytes in NS nanoseconds, in MB/s. */
+void
+bench_throughput (const char *metric, size_t bytes, int64_t ns)
+{
+  int64_t bytes_per_sec = (int64_t) bytes * 1000000000 / ns;
+  int64_t milli_mbps = bytes_per_sec * 1000 / (1024 * 1024);
+
+  msg ("bench %s %lld.%03lld MB/s",
+       metric, milli_mbps / 1000, milli_mbps % 1000);
+}
+
+/* Reports ITERATIONS operations taking NS nanoseconds in total,
+   as nanoseconds per operation. */
+void
+bench_latency (const char *metric, int64_t ns, unsigned iterations)
+{
+  msg ("bench %s %lld ns", metric, ns / (iterations > 0 ? iterations : 1));
+}
+
+/* Reports COUNT events in NS nanoseconds, as events per
+   second. */
+void
+bench_rate (const char *metric, unsigned count, int64_t ns)
+{
+  msg ("bench %s %lld ops/s", metric, (int64_t) count * 1000000000 / ns);
+}
+
+/* Reports a plain COUNT of something measured in UNIT. */
+void
+bench_count (const char *metric, unsigned count, const char *unit)
+{
+  msg ("bench %s %u %s", metric, count, unit);
+}
@@ -0,0 +1,21 @@
+#ifndef TESTS_BENCH_BENCH_H
+#define TESTS_BENCH_BENCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Benchmark results are reported through msg() as lines of the
+   form
+
+     (NAME) bench METRIC VALUE UNIT
+
+   which tests/bench/bench.pm checks and `make bench' collects. */
+
+int64_t bench_start (void);
+int64_t bench_elapsed (int64_t start);
+void bench_throughput (const char *metric, size_t bytes, int64_t ns);
+void bench_latency (const char *metric, int64_t ns, unsigned iterations);
+void bench_rate (const char *metric, unsigned count, int64_t ns);
+void bench_count (const char *metric, unsigned count, const char *unit);
+
+#endif /* tests/bench/bench.h */
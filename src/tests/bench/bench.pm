@@ -0,0 +1,24 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+# Passes if the benchmark ran to completion and reported every
+# metric named in @METRICS.
+sub check_bench {
+    my (@metrics) = @_;
+    our ($test);
+    my (@output) = read_text_file ("$test.output");
+
+    common_checks ("run", @output);
+    @output = get_core_output ("run", @output);
+    foreach my $metric (@metrics) {
+	fail "Output missing result for `$metric'.\n"
+	  if !grep (/^\(\S+\) bench \Q$metric\E \S+ \S+$/, @output);
+    }
+    fail "Benchmark did not finish.\n"
+      if !grep (/^\(\S+\) end$/, @output);
+    pass;
+}
+
+1;
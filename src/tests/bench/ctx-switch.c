@@ -0,0 +1,79 @@
+/* Measures context switching between processes.
+
+   Runs CHILD_CNT children that each spin for SPIN_ITERS
+   iterations, first all at once, so that the timer preempts
+   them in turn, and then one at a time, so that nothing
+   preempts them.  The extra time taken by the concurrent run,
+   divided by the number of preemptions getrusage() reports for
+   it, estimates the cost of one switch. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/bench/bench.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* Number of children and how long each one spins. */
+#define CHILD_CNT 4
+#define SPIN_ITERS 10000000
+
+static void
+exec_spinner (pid_t *pid)
+{
+  char cmd_line[32];
+
+  snprintf (cmd_line, sizeof cmd_line, "bench-spin %d", SPIN_ITERS);
+  CHECK ((*pid = exec (cmd_line)) != PID_ERROR, "exec \"%s\"", cmd_line);
+}
+
+/* Runs the children concurrently and returns the elapsed time. */
+static int64_t
+run_concurrent (void)
+{
+  int64_t start = bench_start ();
+  pid_t pids[CHILD_CNT];
+  size_t i;
+
+  for (i = 0; i < CHILD_CNT; i++)
+    exec_spinner (&pids[i]);
+  for (i = 0; i < CHILD_CNT; i++)
+    wait (pids[i]);
+  return bench_elapsed (start);
+}
+
+/* Runs the children one after another and returns the elapsed
+   time. */
+static int64_t
+run_sequential (void)
+{
+  int64_t start = bench_start ();
+  size_t i;
+
+  for (i = 0; i < CHILD_CNT; i++)
+    {
+      pid_t pid;
+      exec_spinner (&pid);
+      wait (pid);
+    }
+  return bench_elapsed (start);
+}
+
+void
+test_main (void)
+{
+  struct rusage before, after;
+  int64_t concurrent, sequential;
+  unsigned switches;
+
+  CHECK (getrusage (RUSAGE_CHILDREN, &before) == 0, "getrusage");
+  concurrent = run_concurrent ();
+  CHECK (getrusage (RUSAGE_CHILDREN, &after) == 0, "getrusage");
+  sequential = run_sequential ();
+
+  switches = after.involuntary_switches - before.involuntary_switches;
+  bench_count ("preemptions", switches, "switches");
+  bench_rate ("switch-rate", switches, concurrent);
+  bench_latency ("switch-cost",
+                 concurrent > sequential ? concurrent - sequential : 0,
+                 switches);
+}
@@ -0,0 +1,6 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::bench::bench;
+check_bench (qw (preemptions switch-rate switch-cost));
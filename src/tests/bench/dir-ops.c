@@ -0,0 +1,78 @@
+/* Measures creating, looking up, and removing many files in one
+   directory. */
+
+#include <random.h>
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/bench/bench.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* Number of files, and number of times each is looked up. */
+#define FILE_CNT 128
+#define LOOKUP_PASSES 4
+
+static void
+file_name (char name[], size_t size, const char *prefix, int i)
+{
+  snprintf (name, size, "/bench/%s%d", prefix, i);
+}
+
+void
+test_main (void)
+{
+  int order[FILE_CNT];
+  char name[32];
+  int64_t start;
+  int i, pass;
+
+  CHECK (mkdir ("/bench"), "mkdir \"/bench\"");
+
+  start = bench_start ();
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      file_name (name, sizeof name, "f", i);
+      if (!create (name, 0))
+        fail ("create \"%s\"", name);
+    }
+  bench_latency ("dir-create", bench_elapsed (start), FILE_CNT);
+
+  /* Look the files up in random order, so that each lookup does
+     not simply follow the last. */
+  for (i = 0; i < FILE_CNT; i++)
+    order[i] = i;
+  start = bench_start ();
+  for (pass = 0; pass < LOOKUP_PASSES; pass++)
+    {
+      shuffle (order, FILE_CNT, sizeof *order);
+      for (i = 0; i < FILE_CNT; i++)
+        {
+          int fd;
+
+          file_name (name, sizeof name, "f", order[i]);
+          if ((fd = open (name)) < 2)
+            fail ("open \"%s\"", name);
+          close (fd);
+        }
+    }
+  bench_latency ("dir-lookup", bench_elapsed (start),
+                 FILE_CNT * LOOKUP_PASSES);
+
+  start = bench_start ();
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      file_name (name, sizeof name, "missing", i);
+      if (open (name) != -1)
+        fail ("open \"%s\" should have failed", name);
+    }
+  bench_latency ("dir-miss", bench_elapsed (start), FILE_CNT);
+
+  start = bench_start ();
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      file_name (name, sizeof name, "f", i);
+      if (!remove (name))
+        fail ("remove \"%s\"", name);
+    }
+  bench_latency ("dir-remove", bench_elapsed (start), FILE_CNT);
+}
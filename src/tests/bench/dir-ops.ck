@@ -0,0 +1,6 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::bench::bench;
+check_bench (qw (dir-create dir-lookup dir-miss dir-remove));
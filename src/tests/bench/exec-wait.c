@@ -0,0 +1,27 @@
+/* Measures starting a process that exits at once and waiting
+   for it. */
+
+#include <syscall.h>
+#include "tests/bench/bench.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* Number of processes to start. */
+#define ITERATIONS 32
+
+void
+test_main (void)
+{
+  int64_t start = bench_start ();
+  int i;
+
+  for (i = 0; i < ITERATIONS; i++)
+    {
+      pid_t pid = exec ("bench-spin 0");
+      if (pid == PID_ERROR)
+        fail ("exec \"bench-spin 0\"");
+      if (wait (pid) != 0)
+        fail ("wait for \"bench-spin 0\"");
+    }
+  bench_latency ("exec-wait", bench_elapsed (start), ITERATIONS);
+}
@@ -0,0 +1,84 @@
+/* Measures file throughput through the read/write system calls,
+   both sequentially in large blocks and at random sector-sized
+   offsets. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/bench/bench.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* File size.  Kept within the inode's direct blocks. */
+#define FILE_SIZE (48 * 1024)
+
+/* Sequential transfer size and number of passes over the file. */
+#define SEQ_BLOCK 4096
+#define SEQ_PASSES 16
+
+/* Random transfer size and number of transfers. */
+#define RAND_BLOCK 512
+#define RAND_OPS 1024
+
+static char buf[FILE_SIZE];
+
+static void
+sequential (int fd, const char *metric, bool writing)
+{
+  int64_t start = bench_start ();
+  size_t pass, ofs;
+
+  for (pass = 0; pass < SEQ_PASSES; pass++)
+    {
+      seek (fd, 0);
+      for (ofs = 0; ofs < FILE_SIZE; ofs += SEQ_BLOCK)
+        {
+          int n = (writing
+                   ? write (fd, buf + ofs, SEQ_BLOCK)
+                   : read (fd, buf + ofs, SEQ_BLOCK));
+          if (n != SEQ_BLOCK)
+            fail ("%s at offset %zu returned %d", metric, ofs, n);
+        }
+    }
+  bench_throughput (metric, (size_t) FILE_SIZE * SEQ_PASSES,
+                    bench_elapsed (start));
+}
+
+static void
+random_access (int fd, const char *metric, bool writing)
+{
+  int64_t start = bench_start ();
+  size_t i;
+
+  for (i = 0; i < RAND_OPS; i++)
+    {
+      size_t ofs = random_ulong () % (FILE_SIZE / RAND_BLOCK) * RAND_BLOCK;
+      int n;
+
+      seek (fd, ofs);
+      n = (writing
+           ? write (fd, buf + ofs, RAND_BLOCK)
+           : read (fd, buf + ofs, RAND_BLOCK));
+      if (n != RAND_BLOCK)
+        fail ("%s at offset %zu returned %d", metric, ofs, n);
+    }
+  bench_throughput (metric, (size_t) RAND_BLOCK * RAND_OPS,
+                    bench_elapsed (start));
+}
+
+void
+test_main (void)
+{
+  int fd;
+
+  random_bytes (buf, sizeof buf);
+  CHECK (create ("bench", FILE_SIZE), "create \"bench\"");
+  CHECK ((fd = open ("bench")) > 1, "open \"bench\"");
+
+  sequential (fd, "seq-write", true);
+  sequential (fd, "seq-read", false);
+  random_access (fd, "rand-write", true);
+  random_access (fd, "rand-read", false);
+
+  msg ("close \"bench\"");
+  close (fd);
+}
@@ -0,0 +1,47 @@
+/* Measures the cost of touching pages of memory for the first
+   time and again afterward, and reports how many page faults
+   the first touches took.  With a lazily loading virtual memory
+   system, the first touch of each page faults it in. */
+
+#include <syscall.h>
+#include "tests/bench/bench.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* Number of pages to touch, and times to touch them again. */
+#define PAGE_CNT 64
+#define PAGE_SIZE 4096
+#define RETOUCH_PASSES 16
+
+static char pages[PAGE_CNT][PAGE_SIZE];
+
+static void
+touch_all (void)
+{
+  int i;
+
+  for (i = 0; i < PAGE_CNT; i++)
+    pages[i][i % PAGE_SIZE] = i;
+}
+
+void
+test_main (void)
+{
+  struct rusage before, after;
+  int64_t start;
+  int pass;
+
+  CHECK (getrusage (RUSAGE_SELF, &before) == 0, "getrusage");
+  start = bench_start ();
+  touch_all ();
+  bench_latency ("first-touch", bench_elapsed (start), PAGE_CNT);
+  CHECK (getrusage (RUSAGE_SELF, &after) == 0, "getrusage");
+  bench_count ("touch-faults", after.page_faults - before.page_faults,
+               "faults");
+
+  start = bench_start ();
+  for (pass = 0; pass < RETOUCH_PASSES; pass++)
+    touch_all ();
+  bench_latency ("retouch", bench_elapsed (start),
+                 PAGE_CNT * RETOUCH_PASSES);
+}
@@ -0,0 +1,35 @@
+/* Measures the round-trip cost of system calls: one that does
+   almost nothing in the kernel, and one that takes the file
+   system lock. */
+
+#include <syscall.h>
+#include "tests/bench/bench.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* Number of calls to time. */
+#define ITERATIONS 100000
+
+void
+test_main (void)
+{
+  int64_t start;
+  unsigned i;
+  int fd;
+
+  /* tell() on a file descriptor that cannot exist returns at
+     once. */
+  start = bench_start ();
+  for (i = 0; i < ITERATIONS; i++)
+    tell (-1);
+  bench_latency ("null-syscall", bench_elapsed (start), ITERATIONS);
+
+  CHECK (create ("bench", 512), "create \"bench\"");
+  CHECK ((fd = open ("bench")) > 1, "open \"bench\"");
+  start = bench_start ();
+  for (i = 0; i < ITERATIONS; i++)
+    filesize (fd);
+  bench_latency ("filesize-syscall", bench_elapsed (start), ITERATIONS);
+  msg ("close \"bench\"");
+  close (fd);
+}
@@ -0,0 +1,163 @@
+/* Test and benchmark program for the block and string functions
+   in lib/string.c.
+
+   Checks memcpy(), memmove(), memset(), memcmp() and strlen()
+   against simple byte loops at every small size and alignment,
+   then reports their throughput at sizes from 16 bytes to 64 kB.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <random.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "threads/test.h"
+
+/* Largest block that we will benchmark. */
+#define MAX_SIZE (64 * 1024)
+
+/* Largest block and misalignment that we will check exhaustively. */
+#define CHECK_SIZE 80
+#define CHECK_ALIGN 8
+
+/* Bytes to move per benchmark measurement. */
+#define BENCH_BYTES (4 * 1024 * 1024)
+
+static unsigned char src[MAX_SIZE + CHECK_ALIGN];
+static unsigned char dst[MAX_SIZE + CHECK_ALIGN];
+static unsigned char expected[MAX_SIZE + CHECK_ALIGN];
+
+static void check_functions (void);
+static void bench_functions (void);
+
+/* Tests and benchmarks the string functions. */
+void
+test (void) 
+{
+  check_functions ();
+  printf ("string: PASS\n");
+  bench_functions ();
+}
+
+/* Checks each function at every size up to CHECK_SIZE and every
+   source and destination misalignment up to CHECK_ALIGN. */
+static void
+check_functions (void) 
+{
+  size_t size, s, d, i;
+
+  for (size = 0; size <= CHECK_SIZE; size++)
+    for (s = 0; s < CHECK_ALIGN; s++)
+      for (d = 0; d < CHECK_ALIGN; d++)
+        {
+          random_bytes (src, CHECK_SIZE + CHECK_ALIGN);
+          random_bytes (dst, CHECK_SIZE + CHECK_ALIGN);
+
+          /* memcpy(). */
+          memcpy (expected, dst, sizeof expected);
+          for (i = 0; i < size; i++)
+            expected[d + i] = src[s + i];
+          ASSERT (memcpy (dst + d, src + s, size) == dst + d);
+          for (i = 0; i < CHECK_SIZE + CHECK_ALIGN; i++)
+            ASSERT (dst[i] == expected[i]);
+
+          /* memmove(), overlapping in both directions. */
+          memcpy (expected, dst, sizeof expected);
+          for (i = 0; i < size; i++)
+            expected[i] = dst[s + i];
+          ASSERT (memmove (dst, dst + s, size) == dst);
+          for (i = 0; i < CHECK_SIZE + CHECK_ALIGN; i++)
+            ASSERT (dst[i] == expected[i]);
+          for (i = size; i-- > 0; )
+            expected[d + i] = expected[i];
+          ASSERT (memmove (dst + d, dst, size) == dst + d);
+          for (i = 0; i < CHECK_SIZE + CHECK_ALIGN; i++)
+            ASSERT (dst[i] == expected[i]);
+
+          /* memset(). */
+          memcpy (expected, dst, sizeof expected);
+          for (i = 0; i < size; i++)
+            expected[d + i] = s * 37 + size;
+          ASSERT (memset (dst + d, s * 37 + size, size) == dst + d);
+          for (i = 0; i < CHECK_SIZE + CHECK_ALIGN; i++)
+            ASSERT (dst[i] == expected[i]);
+
+          /* memcmp(), equal and with one differing byte. */
+          memcpy (dst + d, src + s, size);
+          ASSERT (memcmp (dst + d, src + s, size) == 0);
+          if (size > 0)
+            {
+              i = random_ulong () % size;
+              dst[d + i] = src[s + i] + 1;
+              ASSERT (memcmp (dst + d, src + s, size)
+                      == (dst[d + i] > src[s + i] ? 1 : -1));
+            }
+
+          /* strlen(). */
+          for (i = 0; i < size; i++)
+            src[s + i] = src[s + i] | 1;
+          src[s + size] = '\0';
+          ASSERT (strlen ((char *) src + s) == size);
+        }
+}
+
+/* Prints the throughput of moving BYTES bytes in NS nanoseconds,
+   in MB/s. */
+static void
+print_throughput (size_t bytes, int64_t ns)
+{
+  printf (" %8lld", ns > 0 ? (int64_t) bytes * 1000 / ns : 0);
+}
+
+/* Reports throughput, in MB/s, for each function at power-of-4
+   block sizes. */
+static void
+bench_functions (void) 
+{
+  size_t size;
+
+  printf ("string: MB/s    memcpy  memmove   memset   memcmp   strlen\n");
+  for (size = 16; size <= MAX_SIZE; size *= 4)
+    {
+      size_t reps = BENCH_BYTES / size;
+      size_t i;
+      int64_t start;
+
+      memset (src, 'x', size);
+      src[size - 1] = '\0';
+      memcpy (dst, src, size);
+      printf ("string: %6zu", size);
+
+      start = timer_ns ();
+      for (i = 0; i < reps; i++)
+        memcpy (dst, src, size);
+      print_throughput (BENCH_BYTES, timer_ns () - start);
+
+      start = timer_ns ();
+      for (i = 0; i < reps; i++)
+        memmove (dst + 1, dst, size - 1);
+      print_throughput (BENCH_BYTES, timer_ns () - start);
+
+      start = timer_ns ();
+      for (i = 0; i < reps; i++)
+        memset (dst, 0, size);
+      print_throughput (BENCH_BYTES, timer_ns () - start);
+
+      memcpy (dst, src, size);
+      start = timer_ns ();
+      for (i = 0; i < reps; i++)
+        ASSERT (memcmp (dst, src, size) == 0);
+      print_throughput (BENCH_BYTES, timer_ns () - start);
+
+      start = timer_ns ();
+      for (i = 0; i < reps; i++)
+        ASSERT (strlen ((char *) src) == size - 1);
+      print_throughput (BENCH_BYTES, timer_ns () - start);
+
+      printf ("\n");
+    }
+}
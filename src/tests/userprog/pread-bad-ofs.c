@@ -0,0 +1,21 @@
+/* Passes pread() an offset past the range of a file position,
+   and one that overflows once the length is added, which must
+   both fail without moving the file position. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  char buf[64];
+  int handle;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK (pread (handle, buf, sizeof buf, 0x80000000) == -1,
+         "pread() at offset 0x80000000 must fail");
+  CHECK (pread (handle, buf, sizeof buf, 0x7ffffff0) == -1,
+         "pread() past offset 0x7fffffff must fail");
+  CHECK (tell (handle) == 0, "pread() left position at 0");
+}
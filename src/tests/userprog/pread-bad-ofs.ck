@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pread-bad-ofs) begin
+(pread-bad-ofs) open "sample.txt"
+(pread-bad-ofs) pread() at offset 0x80000000 must fail
+(pread-bad-ofs) pread() past offset 0x7fffffff must fail
+(pread-bad-ofs) pread() left position at 0
+(pread-bad-ofs) end
+pread-bad-ofs: exit(0)
+EOF
+pass;
@@ -0,0 +1,30 @@
+/* Reads "sample.txt" at various offsets with pread() and checks
+   both the data and that the file position does not move. */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  char buf[64];
+  int handle, byte_cnt;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+
+  byte_cnt = pread (handle, buf, sizeof buf, 10);
+  if (byte_cnt != sizeof buf)
+    fail ("pread() returned %d instead of %zu", byte_cnt, sizeof buf);
+  compare_bytes (buf, sample + 10, sizeof buf, 10, "sample.txt");
+  CHECK (tell (handle) == 0, "pread() left position at 0");
+
+  seek (handle, 3);
+  byte_cnt = pread (handle, buf, sizeof buf, sizeof sample - 1 - 20);
+  if (byte_cnt != 20)
+    fail ("pread() near end of file returned %d instead of 20", byte_cnt);
+  compare_bytes (buf, sample + sizeof sample - 1 - 20, 20,
+                 sizeof sample - 1 - 20, "sample.txt");
+  CHECK (tell (handle) == 3, "pread() left position at 3");
+}
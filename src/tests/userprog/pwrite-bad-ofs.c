@@ -0,0 +1,22 @@
+/* Passes pwrite() an offset past the range of a file position,
+   and one that overflows once the length is added, which must
+   both fail without writing anything. */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  int handle;
+
+  CHECK (create ("test.txt", 0), "create \"test.txt\"");
+  CHECK ((handle = open ("test.txt")) > 1, "open \"test.txt\"");
+  CHECK (pwrite (handle, sample, sizeof sample - 1, 0xffffffff) == -1,
+         "pwrite() at offset 0xffffffff must fail");
+  CHECK (pwrite (handle, sample, sizeof sample - 1, 0x7ffffff0) == -1,
+         "pwrite() past offset 0x7fffffff must fail");
+  CHECK (filesize (handle) == 0, "\"test.txt\" must be empty");
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pwrite-bad-ofs) begin
+(pwrite-bad-ofs) create "test.txt"
+(pwrite-bad-ofs) open "test.txt"
+(pwrite-bad-ofs) pwrite() at offset 0xffffffff must fail
+(pwrite-bad-ofs) pwrite() past offset 0x7fffffff must fail
+(pwrite-bad-ofs) "test.txt" must be empty
+(pwrite-bad-ofs) end
+pwrite-bad-ofs: exit(0)
+EOF
+pass;
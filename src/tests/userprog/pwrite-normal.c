@@ -0,0 +1,32 @@
+/* Writes a file back to front with pwrite() and checks that the
+   file position does not move, then reads it back with read(). */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  size_t half = (sizeof sample - 1) / 2;
+  int handle, byte_cnt;
+
+  CHECK (create ("test.txt", sizeof sample - 1), "create \"test.txt\"");
+  CHECK ((handle = open ("test.txt")) > 1, "open \"test.txt\"");
+
+  byte_cnt = pwrite (handle, sample + half, sizeof sample - 1 - half, half);
+  if (byte_cnt != (int) (sizeof sample - 1 - half))
+    fail ("pwrite() returned %d instead of %zu",
+          byte_cnt, sizeof sample - 1 - half);
+  CHECK (tell (handle) == 0, "pwrite() left position at 0");
+
+  byte_cnt = pwrite (handle, sample, half, 0);
+  if (byte_cnt != (int) half)
+    fail ("pwrite() returned %d instead of %zu", byte_cnt, half);
+  CHECK (tell (handle) == 0, "pwrite() left position at 0");
+  msg ("close \"test.txt\"");
+  close (handle);
+
+  check_file ("test.txt", sample, sizeof sample - 1);
+}
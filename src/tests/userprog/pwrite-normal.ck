@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pwrite-normal) begin
+(pwrite-normal) create "test.txt"
+(pwrite-normal) open "test.txt"
+(pwrite-normal) pwrite() left position at 0
+(pwrite-normal) pwrite() left position at 0
+(pwrite-normal) close "test.txt"
+(pwrite-normal) open "test.txt" for verification
+(pwrite-normal) verified contents of "test.txt"
+(pwrite-normal) close "test.txt"
+(pwrite-normal) end
+pwrite-normal: exit(0)
+EOF
+pass;
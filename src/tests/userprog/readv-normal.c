@@ -0,0 +1,32 @@
+/* Reads "sample.txt" with readv() into three buffers of
+   different sizes, the last one larger than what remains, and
+   checks that the data lands in order. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  char buf[sizeof sample];
+  struct iovec iov[3];
+  int handle, byte_cnt;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+
+  memset (buf, 0, sizeof buf);
+  iov[0].iov_base = buf;
+  iov[0].iov_len = 1;
+  iov[1].iov_base = buf + 1;
+  iov[1].iov_len = 100;
+  iov[2].iov_base = buf + 101;
+  iov[2].iov_len = sizeof buf - 101;
+  byte_cnt = readv (handle, iov, 3);
+  if (byte_cnt != sizeof sample - 1)
+    fail ("readv() returned %d instead of %zu", byte_cnt, sizeof sample - 1);
+  compare_bytes (buf, sample, sizeof sample - 1, 0, "sample.txt");
+  msg ("verified data read by readv()");
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(readv-normal) begin
+(readv-normal) open "sample.txt"
+(readv-normal) verified data read by readv()
+(readv-normal) end
+readv-normal: exit(0)
+EOF
+pass;
@@ -0,0 +1,35 @@
+/* Passes rings whose submission or completion queue claims to
+   hold more than RING_ENTRIES entries to ring_enter(), which
+   must reject them without consuming any submission. */
+
+#include <ring.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static struct ring ring;
+
+void
+test_main (void)
+{
+  ring.sq_head = 5;
+  ring.sq_tail = 5 + RING_ENTRIES + 1;
+  CHECK (ring_enter (&ring) == -1, "too many submissions rejected");
+  CHECK (ring.sq_head == 5 && ring.cq_tail == 0,
+         "no submission consumed");
+
+  /* The submission queue now wraps around, but the completion
+     queue is overfull. */
+  ring.sq_head = 0xfffffffe;
+  ring.sq_tail = 1;
+  ring.cq_head = 0;
+  ring.cq_tail = RING_ENTRIES + 1;
+  CHECK (ring_enter (&ring) == -1, "too many completions rejected");
+  CHECK (ring.sq_head == 0xfffffffe && ring.cq_tail == RING_ENTRIES + 1,
+         "no submission consumed");
+
+  /* The same wrapped submissions are fine with room to
+     complete. */
+  ring.cq_tail = 0;
+  CHECK (ring_enter (&ring) == 3, "wrapped submissions consumed");
+}
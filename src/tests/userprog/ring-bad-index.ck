@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(ring-bad-index) begin
+(ring-bad-index) too many submissions rejected
+(ring-bad-index) no submission consumed
+(ring-bad-index) too many completions rejected
+(ring-bad-index) no submission consumed
+(ring-bad-index) wrapped submissions consumed
+(ring-bad-index) end
+ring-bad-index: exit(0)
+EOF
+pass;
@@ -0,0 +1,27 @@
+/* Submits a read through ring_enter() whose buffer is an
+   invalid pointer.
+   The process must be terminated with -1 exit code. */
+
+#include <ring.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static struct ring ring;
+
+void
+test_main (void)
+{
+  struct ring_sqe *sqe = &ring.sqes[0];
+  int handle;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+
+  sqe->op = RING_READ;
+  sqe->fd = handle;
+  sqe->buf = (char *) 0xc0100000;
+  sqe->len = 123;
+  ring.sq_tail = 1;
+  ring_enter (&ring);
+  fail ("should not have survived ring_enter()");
+}
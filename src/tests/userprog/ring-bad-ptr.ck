@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF', <<'EOF']);
+(ring-bad-ptr) begin
+(ring-bad-ptr) open "sample.txt"
+(ring-bad-ptr) end
+ring-bad-ptr: exit(0)
+EOF
+(ring-bad-ptr) begin
+(ring-bad-ptr) open "sample.txt"
+ring-bad-ptr: exit(-1)
+EOF
+pass;
@@ -0,0 +1,74 @@
+/* Submits two batches of mixed requests through ring_enter() and
+   checks every completion: opening an existing and a missing
+   file and a no-op in the first batch, then reading, writing
+   and closing in the second. */
+
+#include <ring.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static struct ring ring;
+
+/* Queues a request. */
+static void
+submit (enum ring_op op, int fd, void *buf, unsigned len,
+        unsigned user_data)
+{
+  struct ring_sqe *sqe = &ring.sqes[ring.sq_tail % RING_ENTRIES];
+
+  sqe->op = op;
+  sqe->fd = fd;
+  sqe->buf = buf;
+  sqe->len = len;
+  sqe->user_data = user_data;
+  ring.sq_tail++;
+}
+
+/* Reaps the next completion, which must be for USER_DATA, and
+   returns its result. */
+static int
+reap (unsigned user_data)
+{
+  struct ring_cqe *cqe;
+
+  if (ring.cq_head == ring.cq_tail)
+    fail ("no completion for request %u", user_data);
+  cqe = &ring.cqes[ring.cq_head++ % RING_ENTRIES];
+  if (cqe->user_data != user_data)
+    fail ("completion for request %u instead of %u",
+          (unsigned) cqe->user_data, user_data);
+  return cqe->result;
+}
+
+void
+test_main (void)
+{
+  char buf[64];
+  int sample_fd, test_fd;
+
+  CHECK (create ("test.txt", sizeof buf), "create \"test.txt\"");
+  CHECK ((test_fd = open ("test.txt")) > 1, "open \"test.txt\"");
+
+  submit (RING_OPEN, 0, "sample.txt", 0, 1);
+  submit (RING_NOP, 0, NULL, 0, 2);
+  submit (RING_OPEN, 0, "no-such-file", 0, 3);
+  CHECK (ring_enter (&ring) == 3, "submit open, no-op, open");
+  CHECK ((sample_fd = reap (1)) > 1, "open \"sample.txt\" succeeded");
+  CHECK (reap (2) == 0, "no-op returned 0");
+  CHECK (reap (3) == -1, "open \"no-such-file\" failed");
+
+  submit (RING_READ, sample_fd, buf, sizeof buf, 4);
+  submit (RING_WRITE, test_fd, buf, sizeof buf, 5);
+  submit (RING_CLOSE, sample_fd, NULL, 0, 6);
+  CHECK (ring_enter (&ring) == 3, "submit read, write, close");
+  CHECK (reap (4) == (int) sizeof buf, "read returned %zu", sizeof buf);
+  CHECK (reap (5) == (int) sizeof buf, "write returned %zu", sizeof buf);
+  CHECK (reap (6) == 0, "close returned 0");
+  CHECK (ring.sq_head == ring.sq_tail, "submission queue drained");
+
+  msg ("close \"test.txt\"");
+  close (test_fd);
+  check_file ("test.txt", sample, sizeof buf);
+}
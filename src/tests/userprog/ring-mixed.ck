@@ -0,0 +1,25 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(ring-mixed) begin
+(ring-mixed) create "test.txt"
+(ring-mixed) open "test.txt"
+(ring-mixed) submit open, no-op, open
+(ring-mixed) open "sample.txt" succeeded
+(ring-mixed) no-op returned 0
+(ring-mixed) open "no-such-file" failed
+(ring-mixed) submit read, write, close
+(ring-mixed) read returned 64
+(ring-mixed) write returned 64
+(ring-mixed) close returned 0
+(ring-mixed) submission queue drained
+(ring-mixed) close "test.txt"
+(ring-mixed) open "test.txt" for verification
+(ring-mixed) verified contents of "test.txt"
+(ring-mixed) close "test.txt"
+(ring-mixed) end
+ring-mixed: exit(0)
+EOF
+pass;
@@ -0,0 +1,29 @@
+/* Passes a negative buffer count and one larger than IOV_MAX to
+   the writev system call, which must fail both times without
+   writing anything. */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  static struct iovec iov[IOV_MAX + 1];
+  int handle, i;
+
+  CHECK (create ("test.txt", 0), "create \"test.txt\"");
+  CHECK ((handle = open ("test.txt")) > 1, "open \"test.txt\"");
+
+  for (i = 0; i < IOV_MAX + 1; i++)
+    {
+      iov[i].iov_base = sample;
+      iov[i].iov_len = 1;
+    }
+  CHECK (writev (handle, iov, IOV_MAX + 1) == -1,
+         "writev() of IOV_MAX + 1 buffers must fail");
+  CHECK (writev (handle, iov, -1) == -1,
+         "writev() of -1 buffers must fail");
+  CHECK (filesize (handle) == 0, "\"test.txt\" must be empty");
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(writev-bad-cnt) begin
+(writev-bad-cnt) create "test.txt"
+(writev-bad-cnt) open "test.txt"
+(writev-bad-cnt) writev() of IOV_MAX + 1 buffers must fail
+(writev-bad-cnt) writev() of -1 buffers must fail
+(writev-bad-cnt) "test.txt" must be empty
+(writev-bad-cnt) end
+writev-bad-cnt: exit(0)
+EOF
+pass;
@@ -0,0 +1,31 @@
+/* Writes a file with writev() from three buffers, then reads it
+   back with read(). */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  struct iovec iov[3];
+  int handle, byte_cnt;
+
+  CHECK (create ("test.txt", sizeof sample - 1), "create \"test.txt\"");
+  CHECK ((handle = open ("test.txt")) > 1, "open \"test.txt\"");
+
+  iov[0].iov_base = sample;
+  iov[0].iov_len = 70;
+  iov[1].iov_base = sample + 70;
+  iov[1].iov_len = 0;
+  iov[2].iov_base = sample + 70;
+  iov[2].iov_len = sizeof sample - 1 - 70;
+  byte_cnt = writev (handle, iov, 3);
+  if (byte_cnt != sizeof sample - 1)
+    fail ("writev() returned %d instead of %zu", byte_cnt, sizeof sample - 1);
+  msg ("close \"test.txt\"");
+  close (handle);
+
+  check_file ("test.txt", sample, sizeof sample - 1);
+}
@@ -20,8 +20,11 @@
 #include "threads/loader.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/profile.h"
 #include "threads/pte.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "userprog/exception.h"
@@ -98,6 +101,8 @@ main (void)
   palloc_init (user_page_limit);
   malloc_init ();
   paging_init ();
+  trace_init ();
+  profile_init ();
 
   /* Segmentation. */
 #ifdef USERPROG
@@ -258,6 +263,12 @@ parse_options (char **argv)
         random_init (atoi (value));
       else if (!strcmp (name, "-mlfqs"))
         thread_mlfqs = true;
+      else if (!strcmp (name, "-lockstat"))
+        lock_stats_enabled = true;
+      else if (!strcmp (name, "-trace"))
+        trace_pages = value != NULL ? atoi (value) : TRACE_DEFAULT_PAGES;
+      else if (!strcmp (name, "-profile"))
+        profile_pages = value != NULL ? atoi (value) : PROFILE_DEFAULT_PAGES;
 #ifdef USERPROG
       else if (!strcmp (name, "-ul"))
         user_page_limit = atoi (value);
@@ -381,6 +392,11 @@ usage (void)
 #endif
           "  -rs=SEED           Set random number seed to SEED.\n"
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+          "  -lockstat          Keep contention statistics for named locks.\n"
+          "  -trace[=PAGES]     Trace events into a PAGES-page ring, saved to\n"
+          "                     the scratch device at power off.\n"
+          "  -profile[=PAGES]   Sample the running code on each timer tick,\n"
+          "                     saved to the scratch device at power off.\n"
 #ifdef USERPROG
           "  -ul=COUNT          Limit user memory to COUNT pages.\n"
 #endif
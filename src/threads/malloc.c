@@ -13,20 +13,26 @@
 
    The size of each request, in bytes, is rounded up to a power
    of 2 and assigned to the "descriptor" that manages blocks of
-   that size.  The descriptor keeps a list of free blocks.  If
-   the free list is nonempty, one of its blocks is used to
-   satisfy the request.
-
-   Otherwise, a new page of memory, called an "arena", is
-   obtained from the page allocator (if none is available,
-   malloc() returns a null pointer).  The new arena is divided
-   into blocks, all of which are added to the descriptor's free
-   list.  Then we return one of the new blocks.
-
-   When we free a block, we add it to its descriptor's free list.
-   But if the arena that the block was in now has no in-use
-   blocks, we remove all of the arena's blocks from the free list
-   and give the arena back to the page allocator.
+   that size.  Blocks come from pages of memory, called "arenas",
+   obtained from the page allocator.  The descriptor keeps a list
+   of its partially used arenas, and a request is satisfied from
+   the first of them, so that blocks are packed into as few
+   arenas as possible.  If there is none, a new arena is obtained
+   from the page allocator (if none is available, malloc()
+   returns a null pointer).
+
+   Each arena keeps its own list of freed blocks.  Blocks that
+   have never been used are not on any list: an arena hands them
+   out in order, with a bump pointer, once its free list is
+   empty.  So creating an arena does not touch each of its
+   blocks.
+
+   When we free a block, we add it to its arena's free list.  If
+   the arena now has no in-use blocks, it is reset to an
+   unused state and moved to the descriptor's list of empty
+   arenas.  A few empty arenas are kept to be reused; once there
+   are more than that, the surplus is given back to the page
+   allocator in one batch, outside the descriptor's lock.
 
    We can't handle blocks bigger than 2 kB using this scheme,
    because they're too big to fit in a single page with a
@@ -40,10 +46,18 @@ struct desc
   {
     size_t block_size;          /* Size of each element in bytes. */
     size_t blocks_per_arena;    /* Number of blocks in an arena. */
-    struct list free_list;      /* List of free blocks. */
+    struct list partial;        /* Arenas with used and free blocks. */
+    struct list empty;          /* Arenas with no used blocks. */
+    size_t empty_cnt;           /* Number of arenas in `empty'. */
     struct lock lock;           /* Lock. */
   };
 
+/* A descriptor keeps up to ARENA_EMPTY_MAX empty arenas.  When
+   it has more, it returns all but ARENA_EMPTY_KEEP of them to the
+   page allocator at once. */
+#define ARENA_EMPTY_MAX 8
+#define ARENA_EMPTY_KEEP 2
+
 /* Magic number for detecting arena corruption. */
 #define ARENA_MAGIC 0x9a548eed
 
@@ -53,12 +67,15 @@ struct arena
     unsigned magic;             /* Always set to ARENA_MAGIC. */
     struct desc *desc;          /* Owning descriptor, null for big block. */
     size_t free_cnt;            /* Free blocks; pages in big block. */
+    struct list_elem elem;      /* In desc's `partial' or `empty' list. */
+    struct block *free_list;    /* Freed blocks. */
+    size_t carved;              /* Blocks handed out at least once. */
   };
 
 /* Free block. */
 struct block
   {
-    struct list_elem free_elem; /* Free list element. */
+    struct block *next;         /* Next block in arena's free list. */
   };
 
 /* Our set of descriptors. */
@@ -79,7 +96,9 @@ malloc_init (void)
       ASSERT (desc_cnt <= sizeof descs / sizeof *descs);
       d->block_size = block_size;
       d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
-      list_init (&d->free_list);
+      list_init (&d->partial);
+      list_init (&d->empty);
+      d->empty_cnt = 0;
       lock_init (&d->lock);
     }
 }
@@ -120,11 +139,18 @@ malloc (size_t size)
 
   lock_acquire (&d->lock);
 
-  /* If the free list is empty, create a new arena. */
-  if (list_empty (&d->free_list))
+  /* Find an arena with a free block: a partially used one if
+     possible, otherwise an empty one, otherwise a new one. */
+  if (!list_empty (&d->partial))
+    a = list_entry (list_front (&d->partial), struct arena, elem);
+  else if (!list_empty (&d->empty))
+    {
+      a = list_entry (list_pop_front (&d->empty), struct arena, elem);
+      d->empty_cnt--;
+      list_push_front (&d->partial, &a->elem);
+    }
+  else
     {
-      size_t i;
-
       /* Allocate a page. */
       a = palloc_get_page (0);
       if (a == NULL)
@@ -133,21 +159,27 @@ malloc (size_t size)
           return NULL;
         }
 
-      /* Initialize arena and add its blocks to the free list. */
+      /* Initialize arena.  Its blocks are carved as needed. */
       a->magic = ARENA_MAGIC;
       a->desc = d;
       a->free_cnt = d->blocks_per_arena;
-      for (i = 0; i < d->blocks_per_arena; i++)
-        {
-          struct block *b = arena_to_block (a, i);
-          list_push_back (&d->free_list, &b->free_elem);
-        }
+      a->free_list = NULL;
+      a->carved = 0;
+      list_push_front (&d->partial, &a->elem);
     }
 
-  /* Get a block from free list and return it. */
-  b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
-  a = block_to_arena (b);
-  a->free_cnt--;
+  /* Reuse a freed block, or else carve a new one. */
+  if (a->free_list != NULL)
+    {
+      b = a->free_list;
+      a->free_list = b->next;
+    }
+  else
+    b = arena_to_block (a, a->carved++);
+
+  /* A full arena leaves the partial list until a block is freed. */
+  if (--a->free_cnt == 0)
+    list_remove (&a->elem);
   lock_release (&d->lock);
   return b;
 }
@@ -232,26 +264,42 @@ free (void *p)
           memset (b, 0xcc, d->block_size);
 #endif
 
-          lock_acquire (&d->lock);
+          struct list surplus;
 
-          /* Add block to free list. */
-          list_push_front (&d->free_list, &b->free_elem);
+          list_init (&surplus);
+          lock_acquire (&d->lock);
 
-          /* If the arena is now entirely unused, free it. */
-          if (++a->free_cnt >= d->blocks_per_arena)
+          /* Add block to arena's free list.  If the arena was
+             full, it is now partially used. */
+          b->next = a->free_list;
+          a->free_list = b;
+          if (a->free_cnt++ == 0)
+            list_push_front (&d->partial, &a->elem);
+
+          /* If the arena is now entirely unused, reset it so its
+             blocks will be carved afresh, and move it to the
+             empty list.  Trim that list if it is too long. */
+          if (a->free_cnt >= d->blocks_per_arena)
             {
-              size_t i;
-
               ASSERT (a->free_cnt == d->blocks_per_arena);
-              for (i = 0; i < d->blocks_per_arena; i++)
-                {
-                  struct block *b = arena_to_block (a, i);
-                  list_remove (&b->free_elem);
-                }
-              palloc_free_page (a);
+              a->free_list = NULL;
+              a->carved = 0;
+              list_remove (&a->elem);
+              list_push_front (&d->empty, &a->elem);
+              if (++d->empty_cnt > ARENA_EMPTY_MAX)
+                while (d->empty_cnt > ARENA_EMPTY_KEEP)
+                  {
+                    list_push_back (&surplus, list_pop_back (&d->empty));
+                    d->empty_cnt--;
+                  }
             }
 
           lock_release (&d->lock);
+
+          /* Give surplus empty arenas back to the page allocator. */
+          while (!list_empty (&surplus))
+            palloc_free_page (list_entry (list_pop_front (&surplus),
+                                          struct arena, elem));
         }
       else
         {
@@ -280,7 +328,7 @@ block_to_arena (struct block *b)
   return a;
 }
 
-/* Returns the (IDX - 1)'th block within arena A. */
+/* Returns the IDX'th block within arena A. */
 static struct block *
 arena_to_block (struct arena *a, size_t idx)
 {
@@ -2,13 +2,14 @@
 #include <bitmap.h>
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
 #include "threads/loader.h"
-#include "threads/synch.h"
 #include "threads/vaddr.h"
 
 /* Page allocator.  Hands out memory in page-size (or
@@ -23,15 +24,48 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   kernel pool, but that's just fine for demonstration purposes.
 
-/* A memory pool. */
+   Each pool is a binary buddy allocator.  Free memory is kept
+   as blocks of 2**ORDER pages, each aligned (relative to the
+   pool base) to its own size, on one free list per order.  An
+   allocation takes a block from the smallest nonempty list that
+   is big enough, splitting it in halves as needed, and frees any
+   pages past the end of the request.  Freeing a block merges it
+   with its "buddy", the other half of the block it was split
+   from, for as long as the buddy is also free.  Both take time
+   proportional to the number of orders, not the pool size.
+
+   The free blocks themselves hold their list elements.  Per-page
+   metadata records the order of each free block's first page,
+   which is what lets free() find free buddies. */
+
+/* Number of block sizes, 1 page through 2**(PALLOC_ORDERS - 1)
+   pages. */
+#define PALLOC_ORDERS 16
+
+/* Free block, stored in its own first page. */
+struct free_block
+  {
+    struct list_elem elem;              /* Element in a free list. */
+  };
+
+/* A memory pool.  Protected by disabling interrupts rather than
+   by a lock, because thread_schedule_tail() frees the dying
+   thread's page with interrupts already off. */
 
 struct pool
   {
-    struct lock lock;                   /* Mutual exclusion. */
     struct bitmap *used_map;            /* Bitmap of free pages. */
     uint8_t *base;                      /* Base of pool. */
+    size_t page_cnt;                    /* Number of pages in pool. */
+    const char *name;                   /* Name, for statistics. */
+
+    /* Buddy allocator state. */
+    uint8_t *free_order;                /* Per page: order + 1 if page
+                                           starts a free block, else 0. */
+    struct list free_lists[PALLOC_ORDERS]; /* Free blocks by order. */
+    size_t free_cnt[PALLOC_ORDERS];     /* Length of each free list. */
   };
 
 /* Two pools: one for kernel data, one for user pages. */
@@ -40,6 +74,8 @@ static struct pool kernel_pool, user_pool;
 static void init_pool (struct pool *, void *base, size_t page_cnt,
                        const char *name);
 static bool page_from_pool (const struct pool *, void *page);
+static size_t buddy_alloc (struct pool *, size_t page_cnt);
+static void buddy_free (struct pool *, size_t page_idx, size_t page_cnt);
 
 /* Initializes the page allocator.  At most USER_PAGE_LIMIT
    pages are put into the user pool. */
@@ -72,15 +108,21 @@ void *
 palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
 {
   struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+  enum intr_level old_level;
   void *pages;
   size_t page_idx;
 
   if (page_cnt == 0)
     return NULL;
 
-  lock_acquire (&pool->lock);
-  page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-  lock_release (&pool->lock);
+  old_level = intr_disable ();
+  page_idx = buddy_alloc (pool, page_cnt);
+  if (page_idx != BITMAP_ERROR)
+    {
+      ASSERT (bitmap_none (pool->used_map, page_idx, page_cnt));
+      bitmap_set_multiple (pool->used_map, page_idx, page_cnt, true);
+    }
+  intr_set_level (old_level);
 
   if (page_idx != BITMAP_ERROR)
     pages = pool->base + PGSIZE * page_idx;
@@ -119,6 +161,7 @@ void
 palloc_free_multiple (void *pages, size_t page_cnt)
 {
   struct pool *pool;
+  enum intr_level old_level;
   size_t page_idx;
 
   ASSERT (pg_ofs (pages) == 0);
@@ -138,8 +181,11 @@ palloc_free_multiple (void *pages, size_t page_cnt)
   memset (pages, 0xcc, PGSIZE * page_cnt);
 #endif
 
+  old_level = intr_disable ();
   ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
   bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+  buddy_free (pool, page_idx, page_cnt);
+  intr_set_level (old_level);
 }
 
 /* Frees the page at PAGE. */
@@ -149,25 +195,74 @@ palloc_free_page (void *page)
   palloc_free_multiple (page, 1);
 }
 
+/* Prints the number of free blocks of each order in each pool,
+   for diagnosing fragmentation. */
+void
+palloc_print_stats (void)
+{
+  struct pool *pools[] = {&kernel_pool, &user_pool};
+  size_t i;
+
+  for (i = 0; i < sizeof pools / sizeof *pools; i++)
+    {
+      struct pool *p = pools[i];
+      size_t free_pages = 0;
+      int order;
+
+      size_t free_cnt[PALLOC_ORDERS];
+      enum intr_level old_level;
+
+      /* Snapshot the counts, since printing may sleep. */
+      old_level = intr_disable ();
+      memcpy (free_cnt, p->free_cnt, sizeof free_cnt);
+      intr_set_level (old_level);
+
+      printf ("Palloc: %s free blocks by order:", p->name);
+      for (order = 0; order < PALLOC_ORDERS; order++)
+        {
+          free_pages += free_cnt[order] << order;
+          if (free_cnt[order] != 0)
+            printf (" %d:%zu", order, free_cnt[order]);
+        }
+      printf (" (%zu of %zu pages free)\n", free_pages, p->page_cnt);
+    }
+}
+
 /* Initializes pool P as starting at START and ending at END,
    naming it NAME for debugging purposes. */
 static void
 init_pool (struct pool *p, void *base, size_t page_cnt, const char *name)
 {
-  /* We'll put the pool's used_map at its base.
-     Calculate the space needed for the bitmap
-     and subtract it from the pool's size. */
-  size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (page_cnt), PGSIZE);
-  if (bm_pages > page_cnt)
+  /* We'll put the pool's used_map and free_order at its base.
+     Calculate the space needed for them and subtract it from the
+     pool's size. */
+  size_t meta_bytes = bitmap_buf_size (page_cnt) + page_cnt;
+  size_t meta_pages = DIV_ROUND_UP (meta_bytes, PGSIZE);
+  size_t bm_bytes;
+  int order;
+
+  if (meta_pages > page_cnt)
     PANIC ("Not enough memory in %s for bitmap.", name);
-  page_cnt -= bm_pages;
+  page_cnt -= meta_pages;
+  bm_bytes = bitmap_buf_size (page_cnt);
 
   printf ("%zu pages available in %s.\n", page_cnt, name);
 
   /* Initialize the pool. */
-  lock_init (&p->lock);
-  p->used_map = bitmap_create_in_buf (page_cnt, base, bm_pages * PGSIZE);
-  p->base = base + bm_pages * PGSIZE;
+  p->used_map = bitmap_create_in_buf (page_cnt, base, bm_bytes);
+  p->free_order = (uint8_t *) base + bm_bytes;
+  memset (p->free_order, 0, page_cnt);
+  p->base = base + meta_pages * PGSIZE;
+  p->page_cnt = page_cnt;
+  p->name = name;
+  for (order = 0; order < PALLOC_ORDERS; order++)
+    {
+      list_init (&p->free_lists[order]);
+      p->free_cnt[order] = 0;
+    }
+
+  /* Put every page on the free lists. */
+  buddy_free (p, 0, page_cnt);
 }
 
 /* Returns true if PAGE was allocated from POOL,
@@ -181,3 +276,108 @@ page_from_pool (const struct pool *pool, void *page)
 
   return page_no >= start_page && page_no < end_page;
 }
+
+/* Returns the page address of the block at PAGE_IDX in POOL. */
+static struct free_block *
+idx_to_block (const struct pool *pool, size_t page_idx)
+{
+  return (struct free_block *) (pool->base + PGSIZE * page_idx);
+}
+
+/* Removes the free block of ORDER at PAGE_IDX from POOL's free
+   lists. */
+static void
+remove_free_block (struct pool *pool, size_t page_idx, int order)
+{
+  ASSERT (pool->free_order[page_idx] == order + 1);
+  list_remove (&idx_to_block (pool, page_idx)->elem);
+  pool->free_order[page_idx] = 0;
+  pool->free_cnt[order]--;
+}
+
+/* Adds the block of ORDER at PAGE_IDX to POOL's free lists. */
+static void
+add_free_block (struct pool *pool, size_t page_idx, int order)
+{
+  list_push_front (&pool->free_lists[order],
+                   &idx_to_block (pool, page_idx)->elem);
+  pool->free_order[page_idx] = order + 1;
+  pool->free_cnt[order]++;
+}
+
+/* Frees the block of ORDER at PAGE_IDX in POOL, merging it with
+   its buddy for as long as the buddy is free too. */
+static void
+free_block (struct pool *pool, size_t page_idx, int order)
+{
+  while (order < PALLOC_ORDERS - 1)
+    {
+      size_t buddy_idx = page_idx ^ ((size_t) 1 << order);
+      if (buddy_idx + ((size_t) 1 << order) > pool->page_cnt
+          || pool->free_order[buddy_idx] != order + 1)
+        break;
+
+      remove_free_block (pool, buddy_idx, order);
+      if (buddy_idx < page_idx)
+        page_idx = buddy_idx;
+      order++;
+    }
+  add_free_block (pool, page_idx, order);
+}
+
+/* Frees the PAGE_CNT pages at PAGE_IDX in POOL, which need not
+   form a single buddy block, by splitting them into the largest
+   aligned blocks that fit. */
+static void
+buddy_free (struct pool *pool, size_t page_idx, size_t page_cnt)
+{
+  while (page_cnt > 0)
+    {
+      int order = 0;
+      while (order < PALLOC_ORDERS - 1
+             && (page_idx & ((size_t) 1 << order)) == 0
+             && ((size_t) 2 << order) <= page_cnt)
+        order++;
+
+      free_block (pool, page_idx, order);
+      page_idx += (size_t) 1 << order;
+      page_cnt -= (size_t) 1 << order;
+    }
+}
+
+/* Allocates PAGE_CNT contiguous pages from POOL and returns the
+   index of the first, or BITMAP_ERROR if no free block is large
+   enough. */
+static size_t
+buddy_alloc (struct pool *pool, size_t page_cnt)
+{
+  int order, want;
+  size_t page_idx;
+
+  /* Find the smallest order that holds PAGE_CNT pages. */
+  for (want = 0; ((size_t) 1 << want) < page_cnt; want++)
+    if (want == PALLOC_ORDERS - 1)
+      return BITMAP_ERROR;
+
+  /* Take a block from the smallest nonempty list that fits. */
+  for (order = want; order < PALLOC_ORDERS; order++)
+    if (!list_empty (&pool->free_lists[order]))
+      break;
+  if (order == PALLOC_ORDERS)
+    return BITMAP_ERROR;
+  page_idx = pg_no (list_entry (list_front (&pool->free_lists[order]),
+                                struct free_block, elem))
+             - pg_no (pool->base);
+  remove_free_block (pool, page_idx, order);
+
+  /* Split it down to the wanted order, freeing upper halves. */
+  while (order > want)
+    {
+      order--;
+      add_free_block (pool, page_idx + ((size_t) 1 << order), order);
+    }
+
+  /* Give back the pages past the end of the request. */
+  buddy_free (pool, page_idx + page_cnt, ((size_t) 1 << want) - page_cnt);
+  return page_idx;
+}
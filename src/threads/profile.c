@@ -0,0 +1,267 @@
+#include "threads/profile.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/block.h"
+#include "devices/scratch.h"
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#ifdef USERPROG
+#include "userprog/pagedir.h"
+#endif
+
+/* Sampling profiler.
+
+   When the kernel is booted with "-profile[=PAGES]", every timer
+   interrupt calls profile_sample(), which records where the
+   interrupted code was: its EIP, followed by the return
+   addresses found by following the chain of saved frame
+   pointers, up to PROFILE_DEPTH addresses in all.  Samples taken
+   in user mode walk the user stack instead of the kernel stack.
+
+   Samples are counted in a hash table keyed by thread and
+   stack, so that a long run costs no more memory than the
+   number of distinct places it spends time.  At power off,
+   profile_dump() writes the table to the scratch device, where
+   utils/pintos-prof symbolizes it against kernel.o and the user
+   programs that ran, producing a flat profile or folded stacks.
+
+   The dump begins with one sector holding a `struct
+   profile_header', followed by the table's used entries packed
+   back to back. */
+
+/* Identifies a profile dump. */
+#define PROFILE_MAGIC "PINPROF1"
+
+/* Maximum number of addresses recorded per sample. */
+#define PROFILE_DEPTH 8
+
+/* Flags in struct profile_entry. */
+#define PROFILE_USER 1          /* Sample taken in user mode. */
+
+/* One distinct stack and the number of times it was sampled.
+   All fields are little-endian on disk. */
+struct profile_entry
+  {
+    uint32_t count;             /* Samples; 0 for an unused entry. */
+    int32_t tid;                /* Thread that was running. */
+    uint32_t flags;             /* PROFILE_* flags. */
+    uint32_t depth;             /* Number of valid addresses in pcs[]. */
+    uint32_t pcs[PROFILE_DEPTH]; /* Interrupted EIP, then callers. */
+    char name[16];              /* Thread name, for finding binaries. */
+  };
+
+/* Header at the start of a dump. */
+struct profile_header
+  {
+    char magic[8];              /* PROFILE_MAGIC, not null-terminated. */
+    uint32_t entry_size;        /* sizeof (struct profile_entry). */
+    uint32_t entry_cnt;         /* Number of entries that follow. */
+    uint32_t sample_cnt;        /* Samples taken. */
+    uint32_t lost_cnt;          /* Samples not counted: table full. */
+    uint32_t frequency;         /* Samples per second. */
+  };
+
+size_t profile_pages;
+bool profile_enabled;
+
+/* Hash table of samples. */
+static struct profile_entry *table;
+static size_t table_cap;        /* Number of entries. */
+static size_t entry_cnt;        /* Number of entries in use. */
+static uint32_t sample_cnt;     /* Samples taken. */
+static uint32_t lost_cnt;       /* Samples dropped. */
+
+static size_t walk_kernel (uint32_t ebp, uint32_t *pcs, size_t depth);
+static size_t walk_user (uint32_t ebp, uint32_t *pcs, size_t depth);
+static struct profile_entry *find_entry (const struct profile_entry *);
+
+/* Allocates the sample table and starts profiling, if the
+   "-profile" option asked for it.  Must be called after
+   palloc_init(). */
+void
+profile_init (void)
+{
+  if (profile_pages == 0)
+    return;
+
+  table = palloc_get_multiple (PAL_ZERO, profile_pages);
+  if (table == NULL)
+    {
+      printf ("profile: couldn't allocate %zu pages, profiling disabled\n",
+              profile_pages);
+      return;
+    }
+  table_cap = profile_pages * PGSIZE / sizeof *table;
+  profile_enabled = true;
+}
+
+/* Records a sample of the code interrupted by F.  Called by the
+   timer interrupt handler, with interrupts off. */
+void
+profile_sample (const struct intr_frame *f)
+{
+  struct thread *t = thread_current ();
+  struct profile_entry sample, *e;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  sample_cnt++;
+  memset (&sample, 0, sizeof sample);
+  sample.tid = t->tid;
+  strlcpy (sample.name, t->name, sizeof sample.name);
+  sample.pcs[0] = (uint32_t) f->eip;
+  if (is_user_vaddr (f->eip))
+    {
+      sample.flags = PROFILE_USER;
+      sample.depth = 1 + walk_user (f->ebp, sample.pcs + 1,
+                                    PROFILE_DEPTH - 1);
+    }
+  else
+    sample.depth = 1 + walk_kernel (f->ebp, sample.pcs + 1,
+                                    PROFILE_DEPTH - 1);
+
+  e = find_entry (&sample);
+  if (e == NULL)
+    lost_cnt++;
+  else if (e->count++ == 0)
+    {
+      memcpy (e, &sample, sizeof *e);
+      e->count = 1;
+      entry_cnt++;
+    }
+}
+
+/* Stops profiling and writes the sample table to the scratch
+   device.  Entries that do not fit are left out. */
+void
+profile_dump (void)
+{
+  struct profile_header header;
+  size_t i, cnt;
+
+  if (!profile_enabled)
+    return;
+  profile_enabled = false;
+
+  if (!scratch_dump_open ())
+    {
+      printf ("profile: no scratch device, profile not saved\n");
+      return;
+    }
+  if (scratch_dump_avail () < BLOCK_SECTOR_SIZE)
+    {
+      printf ("profile: scratch device full, profile not saved\n");
+      return;
+    }
+
+  cnt = (scratch_dump_avail () - BLOCK_SECTOR_SIZE) / sizeof *table;
+  if (cnt > entry_cnt)
+    cnt = entry_cnt;
+
+  memset (&header, 0, sizeof header);
+  memcpy (header.magic, PROFILE_MAGIC, sizeof header.magic);
+  header.entry_size = sizeof *table;
+  header.entry_cnt = cnt;
+  header.sample_cnt = sample_cnt;
+  header.lost_cnt = lost_cnt;
+  header.frequency = TIMER_FREQ;
+  scratch_dump_write (&header, sizeof header);
+  scratch_dump_flush ();
+
+  for (i = 0; i < table_cap && cnt > 0; i++)
+    if (table[i].count > 0)
+      {
+        scratch_dump_write (&table[i], sizeof table[i]);
+        cnt--;
+      }
+  scratch_dump_flush ();
+
+  printf ("profile: saved %zu stacks from %"PRIu32" samples "
+          "to scratch device\n", entry_cnt, sample_cnt);
+}
+
+/* Follows the chain of frame pointers starting at EBP on the
+   running thread's kernel stack, storing up to DEPTH return
+   addresses in PCS.  Returns the number stored.  Stops at any
+   frame pointer outside the stack, so that a frame pointer
+   clobbered by code built without one cannot lead us astray. */
+static size_t
+walk_kernel (uint32_t ebp, uint32_t *pcs, size_t depth)
+{
+  uint32_t stack = (uint32_t) thread_current ();
+  size_t n = 0;
+
+  while (n < depth && ebp > stack && ebp <= stack + PGSIZE - 8
+         && ebp % 4 == 0)
+    {
+      const uint32_t *frame = (const uint32_t *) ebp;
+      if (frame[1] == 0)
+        break;
+      pcs[n++] = frame[1];
+      if (frame[0] <= ebp)
+        break;
+      ebp = frame[0];
+    }
+  return n;
+}
+
+/* Follows the chain of frame pointers starting at EBP on the
+   running process's user stack, storing up to DEPTH return
+   addresses in PCS.  Returns the number stored.  User memory is
+   read through the page directory, so that a bogus frame
+   pointer cannot cause a page fault inside the timer
+   interrupt. */
+static size_t
+walk_user (uint32_t ebp UNUSED, uint32_t *pcs UNUSED, size_t depth UNUSED)
+{
+  size_t n = 0;
+#ifdef USERPROG
+  uint32_t *pd = thread_current ()->pagedir;
+
+  while (pd != NULL && n < depth && ebp % 4 == 0
+         && is_user_vaddr ((void *) (ebp + 4))
+         && pg_ofs ((void *) ebp) <= PGSIZE - 8)
+    {
+      const uint32_t *frame = pagedir_get_page (pd, (void *) ebp);
+      if (frame == NULL || frame[1] == 0)
+        break;
+      pcs[n++] = frame[1];
+      if (frame[0] <= ebp)
+        break;
+      ebp = frame[0];
+    }
+#endif
+  return n;
+}
+
+/* Returns the entry in the table for SAMPLE's thread and stack,
+   which is unused (count 0) if SAMPLE has not been seen before.
+   Returns a null pointer if the table is full. */
+static struct profile_entry *
+find_entry (const struct profile_entry *sample)
+{
+  unsigned hash = sample->tid;
+  size_t i, probes;
+
+  for (i = 0; i < sample->depth; i++)
+    hash = hash * 31 + sample->pcs[i];
+
+  for (probes = 0, i = hash % table_cap; probes < table_cap;
+       probes++, i = (i + 1) % table_cap)
+    {
+      struct profile_entry *e = &table[i];
+      if (e->count == 0)
+        return entry_cnt < table_cap * 3 / 4 ? e : NULL;
+      if (e->tid == sample->tid && e->depth == sample->depth
+          && e->flags == sample->flags
+          && !memcmp (e->pcs, sample->pcs, sizeof e->pcs))
+        return e;
+    }
+  return NULL;
+}
@@ -0,0 +1,25 @@
+#ifndef THREADS_PROFILE_H
+#define THREADS_PROFILE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Sampling profiler.  See profile.c. */
+
+struct intr_frame;
+
+/* Default size of the sample table, in pages. */
+#define PROFILE_DEFAULT_PAGES 16
+
+/* Size of the sample table in pages, or 0 if profiling is off.
+   Set by the "-profile" kernel option. */
+extern size_t profile_pages;
+
+/* True once the profiler is ready to take samples. */
+extern bool profile_enabled;
+
+void profile_init (void);
+void profile_sample (const struct intr_frame *);
+void profile_dump (void);
+
+#endif /* threads/profile.h */
@@ -0,0 +1,317 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <list.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* A slab allocator for fixed-size kernel objects, after
+   Bonwick, "The Slab Allocator: An Object-Caching Kernel Memory
+   Allocator".
+
+   malloc() rounds every request up to a power of 2, so a
+   structure just over a power of 2 wastes nearly half of its
+   block.  A cache created with kmem_cache_create() instead
+   serves objects of exactly one size, packed back to back
+   (rounded only to word alignment) into one-page "slabs" that
+   each start with a `struct slab' header.
+
+   A cache keeps its slabs on three lists, by how many of their
+   objects are in use: full, partial, and empty.  Allocation
+   prefers a partial slab, so that objects pack into as few
+   slabs as possible, then an empty one, and only then gets a
+   new page from the page allocator.  Objects are carved from a
+   slab lazily, one at a time, as the slab's free list runs out.
+
+   A cache may have a constructor, which is run on each object
+   when it is carved.  Such objects are freed back to the cache
+   still constructed, and kmem_cache_alloc() hands them out
+   again without reinitializing them, which saves work for
+   objects with expensive invariant state such as embedded
+   locks.  The free-list link of a constructed object is kept
+   in an extra word after the object so that it does not
+   clobber that state.
+
+   Caches are never destroyed, so their descriptors come from a
+   fixed table, which also lets caches be created before
+   malloc_init(). */
+
+/* Maximum number of caches. */
+#define KMEM_CACHE_MAX 16
+
+/* Number of empty slabs a cache keeps instead of returning them
+   to the page allocator, to avoid thrashing when a single
+   object is repeatedly allocated and freed. */
+#define KMEM_EMPTY_MAX 1
+
+/* Magic number for detecting slab corruption. */
+#define SLAB_MAGIC 0x51ab0b1e
+
+/* Object cache. */
+struct kmem_cache
+  {
+    char name[16];              /* Name, for statistics. */
+    size_t obj_size;            /* Requested object size. */
+    size_t stride;              /* Bytes between adjacent objects. */
+    size_t link_ofs;            /* Offset of free-list link in object. */
+    size_t objs_per_slab;       /* Objects in each slab. */
+    kmem_ctor_func *ctor;       /* Constructor, or null. */
+
+    struct lock lock;           /* Protects everything below. */
+    struct list full;           /* Slabs with no free objects. */
+    struct list partial;        /* Slabs with some free objects. */
+    struct list empty;          /* Slabs with no objects in use. */
+    size_t slab_cnt;            /* Number of slabs. */
+    size_t empty_cnt;           /* Number of slabs in `empty'. */
+    size_t in_use;              /* Objects allocated. */
+    size_t peak_in_use;         /* Maximum value of `in_use'. */
+    unsigned long long alloc_cnt; /* Calls to kmem_cache_alloc(). */
+    unsigned long long slab_alloc_cnt; /* Slabs obtained from palloc. */
+  };
+
+/* Slab header, at the start of each slab's page. */
+struct slab
+  {
+    unsigned magic;             /* Always set to SLAB_MAGIC. */
+    struct kmem_cache *cache;   /* Owning cache. */
+    struct list_elem elem;      /* Element in one of the cache's lists. */
+    size_t in_use;              /* Objects allocated from this slab. */
+    size_t carved;              /* Objects carved so far. */
+    void *free;                 /* Free list of carved objects. */
+  };
+
+/* Our set of caches. */
+static struct kmem_cache caches[KMEM_CACHE_MAX];
+static size_t cache_cnt;
+
+static struct slab *slab_create (struct kmem_cache *);
+static struct slab *obj_to_slab (struct kmem_cache *, void *);
+static void **obj_link (struct kmem_cache *, void *);
+
+/* Creates and returns a cache of SIZE-byte objects named NAME.
+   If CTOR is nonnull, it is called on each object the first
+   time the object is carved from a slab.  Panics if the cache
+   table is full.
+
+   Caches are created while the kernel initializes, before
+   other threads run, so no locking is needed here. */
+struct kmem_cache *
+kmem_cache_create (const char *name, size_t size, kmem_ctor_func *ctor)
+{
+  struct kmem_cache *c;
+
+  ASSERT (name != NULL);
+  ASSERT (size > 0);
+
+  if (cache_cnt >= KMEM_CACHE_MAX)
+    PANIC ("too many kmem caches creating \"%s\"", name);
+  c = &caches[cache_cnt++];
+
+  strlcpy (c->name, name, sizeof c->name);
+  c->obj_size = size;
+  c->ctor = ctor;
+  if (ctor != NULL)
+    {
+      c->link_ofs = ROUND_UP (size, sizeof (void *));
+      c->stride = c->link_ofs + sizeof (void *);
+    }
+  else
+    {
+      c->link_ofs = 0;
+      c->stride = ROUND_UP (size, sizeof (void *));
+    }
+  c->objs_per_slab = (PGSIZE - sizeof (struct slab)) / c->stride;
+  ASSERT (c->objs_per_slab > 0);
+
+  lock_init (&c->lock);
+  list_init (&c->full);
+  list_init (&c->partial);
+  list_init (&c->empty);
+  c->slab_cnt = c->empty_cnt = 0;
+  c->in_use = c->peak_in_use = 0;
+  c->alloc_cnt = c->slab_alloc_cnt = 0;
+  return c;
+}
+
+/* Allocates and returns an object from cache C.  Returns a null
+   pointer if memory is not available. */
+void *
+kmem_cache_alloc (struct kmem_cache *c)
+{
+  struct slab *s;
+  void *obj;
+
+  lock_acquire (&c->lock);
+
+  /* Find a slab with a free object. */
+  if (!list_empty (&c->partial))
+    s = list_entry (list_front (&c->partial), struct slab, elem);
+  else if (!list_empty (&c->empty))
+    {
+      s = list_entry (list_pop_front (&c->empty), struct slab, elem);
+      c->empty_cnt--;
+      list_push_front (&c->partial, &s->elem);
+    }
+  else
+    {
+      s = slab_create (c);
+      if (s == NULL)
+        {
+          lock_release (&c->lock);
+          return NULL;
+        }
+      list_push_front (&c->partial, &s->elem);
+    }
+
+  /* Reuse a freed object, or else carve a new one. */
+  if (s->free != NULL)
+    {
+      obj = s->free;
+      s->free = *obj_link (c, obj);
+    }
+  else
+    {
+      ASSERT (s->carved < c->objs_per_slab);
+      obj = (uint8_t *) (s + 1) + s->carved++ * c->stride;
+      if (c->ctor != NULL)
+        c->ctor (obj);
+    }
+
+  if (++s->in_use == c->objs_per_slab)
+    {
+      list_remove (&s->elem);
+      list_push_front (&c->full, &s->elem);
+    }
+  if (++c->in_use > c->peak_in_use)
+    c->peak_in_use = c->in_use;
+  c->alloc_cnt++;
+
+  lock_release (&c->lock);
+  return obj;
+}
+
+/* Returns OBJ, which must have been allocated from cache C, to
+   C.  If C has a constructor, OBJ must be in its constructed
+   state. */
+void
+kmem_cache_free (struct kmem_cache *c, void *obj)
+{
+  struct slab *s;
+
+  if (obj == NULL)
+    return;
+  s = obj_to_slab (c, obj);
+
+#ifndef NDEBUG
+  /* Clear the object to help detect use-after-free bugs, unless
+     that would destroy its constructed state. */
+  if (c->ctor == NULL)
+    memset (obj, 0xcc, c->obj_size);
+#endif
+
+  lock_acquire (&c->lock);
+  *obj_link (c, obj) = s->free;
+  s->free = obj;
+  c->in_use--;
+
+  if (s->in_use-- == c->objs_per_slab)
+    {
+      /* Full slab is now partial. */
+      list_remove (&s->elem);
+      list_push_front (&c->partial, &s->elem);
+    }
+  if (s->in_use == 0)
+    {
+      /* Slab is now empty.  Keep a few around, free the rest. */
+      list_remove (&s->elem);
+      if (c->empty_cnt < KMEM_EMPTY_MAX)
+        {
+          list_push_front (&c->empty, &s->elem);
+          c->empty_cnt++;
+        }
+      else
+        {
+          c->slab_cnt--;
+          palloc_free_page (s);
+        }
+    }
+  lock_release (&c->lock);
+}
+
+/* Prints usage and fragmentation for each cache.  Fragmentation
+   is the share of the cache's slab pages not occupied by
+   allocated objects; for comparison, the "malloc" column gives
+   the share malloc() would lose to rounding alone. */
+void
+kmem_print_stats (void)
+{
+  size_t i;
+
+  for (i = 0; i < cache_cnt; i++)
+    {
+      struct kmem_cache *c = &caches[i];
+      size_t total, frag, malloc_size;
+
+      lock_acquire (&c->lock);
+      total = c->slab_cnt * PGSIZE;
+      frag = total > 0 ? (total - c->in_use * c->obj_size) * 100 / total : 0;
+      for (malloc_size = 16; malloc_size < c->obj_size; malloc_size *= 2)
+        continue;
+      printf ("Slab: %-15s %4zu B, %zu/%zu in use (peak %zu), "
+              "%zu slabs, %zu%% fragmented (malloc %zu%%), "
+              "%llu allocs, %llu slab allocs\n",
+              c->name, c->obj_size, c->in_use,
+              c->slab_cnt * c->objs_per_slab, c->peak_in_use,
+              c->slab_cnt, frag,
+              (malloc_size - c->obj_size) * 100 / malloc_size,
+              c->alloc_cnt, c->slab_alloc_cnt);
+      lock_release (&c->lock);
+    }
+}
+
+/* Obtains a new, empty slab for cache C, which must be locked.
+   Returns a null pointer if memory is not available. */
+static struct slab *
+slab_create (struct kmem_cache *c)
+{
+  struct slab *s = palloc_get_page (0);
+  if (s == NULL)
+    return NULL;
+
+  s->magic = SLAB_MAGIC;
+  s->cache = c;
+  s->in_use = 0;
+  s->carved = 0;
+  s->free = NULL;
+  c->slab_cnt++;
+  c->slab_alloc_cnt++;
+  return s;
+}
+
+/* Returns the slab that OBJ, allocated from cache C, is in. */
+static struct slab *
+obj_to_slab (struct kmem_cache *c, void *obj)
+{
+  struct slab *s = pg_round_down (obj);
+
+  /* Check that the slab is valid and belongs to C. */
+  ASSERT (s != NULL);
+  ASSERT (s->magic == SLAB_MAGIC);
+  ASSERT (s->cache == c);
+
+  /* Check that the object is properly aligned for the slab. */
+  ASSERT ((pg_ofs (obj) - sizeof *s) % c->stride == 0);
+
+  return s;
+}
+
+/* Returns the location of OBJ's free-list link. */
+static void **
+obj_link (struct kmem_cache *c, void *obj)
+{
+  return (void **) ((uint8_t *) obj + c->link_ofs);
+}
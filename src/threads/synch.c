@@ -27,11 +27,51 @@
 */
 
 #include "threads/synch.h"
+#include <inttypes.h>
 #include <stdio.h>
 #include <string.h>
+#include "devices/timer.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 
+/* Maximum number of times lock_acquire_adaptive() polls a lock
+   before blocking. */
+#define LOCK_SPIN_MAX 100
+
+/* Maximum depth of nested priority donation.  Bounds the work
+   done in lock_acquire() and guards against cycles caused by
+   buggy lock usage. */
+#define DONATION_DEPTH 8
+
+/* Maximum number of distinct lock names with statistics. */
+#define LOCK_STATS_MAX 32
+
+/* Contention statistics, shared by every lock or semaphore
+   given the same name.  Times are in nanoseconds. */
+struct lock_stats
+  {
+    const char *name;           /* Name. */
+    unsigned long long acquire_cnt;   /* Acquisitions. */
+    unsigned long long contended_cnt; /* Acquisitions that had to wait. */
+    int64_t wait_total;         /* Total time spent waiting. */
+    int64_t wait_max;           /* Longest wait. */
+    int64_t hold_total;         /* Total time held. */
+    int64_t hold_max;           /* Longest hold. */
+  };
+
+/* Statistics for each lock name. */
+static struct lock_stats stats_table[LOCK_STATS_MAX];
+static size_t stats_cnt;
+
+bool lock_stats_enabled;
+
+static void donate_priority (struct thread *);
+static void adopt_donors (struct lock *);
+static struct lock_stats *stats_lookup (const char *name);
+static void stats_acquired (struct lock_stats *, bool contended,
+                            int64_t start, int64_t now);
+static void stats_released (struct lock_stats *, int64_t start);
+
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
    manipulating it:
@@ -48,6 +88,19 @@ sema_init (struct semaphore *sema, unsigned value)
 
   sema->value = value;
   list_init (&sema->waiters);
+  sema->stats = NULL;
+}
+
+/* Names SEMA, so that if lock statistics are enabled, the time
+   threads spend waiting in sema_down() on it is recorded under
+   NAME.  NAME must remain valid for as long as the kernel
+   runs. */
+void
+sema_set_name (struct semaphore *sema, const char *name)
+{
+  ASSERT (sema != NULL);
+
+  sema->stats = stats_lookup (name);
 }
 
 /* Down or "P" operation on a semaphore.  Waits for SEMA's value
@@ -62,16 +115,24 @@ sema_down (struct semaphore *sema)
 {
   enum intr_level old_level;
 
+  bool contended;
+  int64_t start = 0;
+
   ASSERT (sema != NULL);
   ASSERT (!intr_context ());
 
   old_level = intr_disable ();
+  contended = sema->value == 0;
+  if (sema->stats != NULL)
+    start = timer_ns ();
   while (sema->value == 0) 
     {
       list_push_back (&sema->waiters, &thread_current ()->elem);
       thread_block ();
     }
   sema->value--;
+  if (sema->stats != NULL)
+    stats_acquired (sema->stats, contended, start, timer_ns ());
   intr_set_level (old_level);
 }
 
@@ -102,7 +163,9 @@ sema_try_down (struct semaphore *sema)
 }
 
 /* Up or "V" operation on a semaphore.  Increments SEMA's value
-   and wakes up one thread of those waiting for SEMA, if any.
+   and wakes up the highest-priority thread of those waiting for
+   SEMA, if any.  Yields the CPU if the woken thread has a higher
+   priority than the running thread.
 
    This function may be called from an interrupt handler. */
 void
@@ -114,10 +177,18 @@ sema_up (struct semaphore *sema)
 
   old_level = intr_disable ();
   if (!list_empty (&sema->waiters)) 
-    thread_unblock (list_entry (list_pop_front (&sema->waiters),
-                                struct thread, elem));
+    {
+      /* Waiters' priorities may have changed through donation
+         since they blocked, so pick the maximum now. */
+      struct list_elem *e = list_max (&sema->waiters,
+                                      thread_priority_less, NULL);
+      list_remove (e);
+      thread_unblock (list_entry (e, struct thread, elem));
+    }
   sema->value++;
   intr_set_level (old_level);
+
+  thread_preempt ();
 }
 
 static void sema_test_helper (void *sema_);
@@ -179,12 +250,30 @@ lock_init (struct lock *lock)
 
   lock->holder = NULL;
   sema_init (&lock->semaphore, 1);
+  lock->stats = NULL;
+  lock->acquire_time = 0;
+}
+
+/* Names LOCK, so that if lock statistics are enabled, its
+   acquisitions, waits, and hold times are recorded under NAME.
+   Locks with the same name share one set of statistics.  NAME
+   must remain valid for as long as the kernel runs. */
+void
+lock_set_name (struct lock *lock, const char *name)
+{
+  ASSERT (lock != NULL);
+
+  lock->stats = stats_lookup (name);
 }
 
 /* Acquires LOCK, sleeping until it becomes available if
    necessary.  The lock must not already be held by the current
    thread.
 
+   If the lock is held by a lower-priority thread, the current
+   thread donates its priority to the holder, and onward through
+   any chain of locks the holder is itself waiting on.
+
    This function may sleep, so it must not be called within an
    interrupt handler.  This function may be called with
    interrupts disabled, but interrupts will be turned back on if
@@ -192,12 +281,83 @@ lock_init (struct lock *lock)
 void
 lock_acquire (struct lock *lock)
 {
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+  bool contended;
+  int64_t start = 0;
+
   ASSERT (lock != NULL);
   ASSERT (!intr_context ());
   ASSERT (!lock_held_by_current_thread (lock));
 
+  old_level = intr_disable ();
+  contended = lock->holder != NULL;
+  if (lock->stats != NULL)
+    start = timer_ns ();
+  if (contended && !thread_mlfqs)
+    {
+      cur->waiting_lock = lock;
+      list_push_back (&lock->holder->donors, &cur->donor_elem);
+      donate_priority (cur);
+    }
+
   sema_down (&lock->semaphore);
-  lock->holder = thread_current ();
+  cur->waiting_lock = NULL;
+  lock->holder = cur;
+  adopt_donors (lock);
+  if (lock->stats != NULL)
+    {
+      lock->acquire_time = timer_ns ();
+      stats_acquired (lock->stats, contended, start, lock->acquire_time);
+    }
+  intr_set_level (old_level);
+}
+
+/* Propagates T's priority to the holder of the lock T is waiting
+   on, and from there along the chain of lock holders, stopping
+   once a holder already has at least that priority.  Must be
+   called with interrupts off. */
+static void
+donate_priority (struct thread *t)
+{
+  int depth;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  for (depth = 0; depth < DONATION_DEPTH; depth++)
+    {
+      struct thread *holder;
+
+      if (t->waiting_lock == NULL)
+        break;
+      holder = t->waiting_lock->holder;
+      if (holder == NULL || holder->priority >= t->priority)
+        break;
+      holder->priority = t->priority;
+      t = holder;
+    }
+}
+
+/* Makes the threads still waiting on LOCK donors to its new
+   holder, the current thread.  lock_release() took them off the
+   old holder's donors list, and only one of them got the lock.
+   Must be called with interrupts off. */
+static void
+adopt_donors (struct lock *lock)
+{
+  struct list *waiters = &lock->semaphore.waiters;
+  struct list_elem *e;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (thread_mlfqs || list_empty (waiters))
+    return;
+  for (e = list_begin (waiters); e != list_end (waiters); e = list_next (e))
+    {
+      struct thread *t = list_entry (e, struct thread, elem);
+      list_push_back (&lock->holder->donors, &t->donor_elem);
+    }
+  thread_update_priority (lock->holder);
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -210,29 +370,97 @@ bool
 lock_try_acquire (struct lock *lock)
 {
   bool success;
+  enum intr_level old_level;
 
   ASSERT (lock != NULL);
   ASSERT (!lock_held_by_current_thread (lock));
 
+  old_level = intr_disable ();
   success = sema_try_down (&lock->semaphore);
   if (success)
-    lock->holder = thread_current ();
+    {
+      lock->holder = thread_current ();
+      adopt_donors (lock);
+      if (lock->stats != NULL)
+        {
+          lock->acquire_time = timer_ns ();
+          stats_acquired (lock->stats, false, lock->acquire_time,
+                          lock->acquire_time);
+        }
+    }
+  intr_set_level (old_level);
   return success;
 }
 
+/* Acquires LOCK like lock_acquire(), but first spins for a
+   short while if LOCK is held by a thread that is running on
+   another CPU.  Meant for locks whose critical sections are only
+   a few instructions long, where the holder will usually release
+   the lock sooner than a block and wakeup could complete.
+
+   A holder that is not running cannot release the lock until it
+   is scheduled, so spinning would only waste time; in that case,
+   which includes every case on a uniprocessor, this blocks at
+   once.  The holder's status is read without synchronization,
+   which is harmless because it is only a hint. */
+void
+lock_acquire_adaptive (struct lock *lock)
+{
+  int spins;
+
+  ASSERT (lock != NULL);
+  ASSERT (!intr_context ());
+
+  for (spins = 0; spins < LOCK_SPIN_MAX; spins++)
+    {
+      struct thread *holder = lock->holder;
+
+      if (lock_try_acquire (lock))
+        return;
+      if (holder == NULL || holder == thread_current ()
+          || holder->status != THREAD_RUNNING)
+        break;
+      asm volatile ("pause");
+    }
+  lock_acquire (lock);
+}
+
 /* Releases LOCK, which must be owned by the current thread.
 
+   Any priority donated on account of LOCK is given up, so the
+   current thread's priority falls back to its base priority or
+   to the highest donation it still receives through other
+   locks.
+
    An interrupt handler cannot acquire a lock, so it does not
    make sense to try to release a lock within an interrupt
    handler. */
 void
 lock_release (struct lock *lock) 
 {
+  struct thread *cur = thread_current ();
+  struct list_elem *e;
+  enum intr_level old_level;
+
   ASSERT (lock != NULL);
   ASSERT (lock_held_by_current_thread (lock));
 
+  old_level = intr_disable ();
+  for (e = list_begin (&cur->donors); e != list_end (&cur->donors); )
+    {
+      struct thread *donor = list_entry (e, struct thread, donor_elem);
+      if (donor->waiting_lock == lock)
+        e = list_remove (e);
+      else
+        e = list_next (e);
+    }
+  thread_update_priority (cur);
+
+  if (lock->stats != NULL)
+    stats_released (lock->stats, lock->acquire_time);
   lock->holder = NULL;
   sema_up (&lock->semaphore);
+  intr_set_level (old_level);
 }
 
 /* Returns true if the current thread holds LOCK, false
@@ -251,8 +479,23 @@ struct semaphore_elem
   {
     struct list_elem elem;              /* List element. */
     struct semaphore semaphore;         /* This semaphore. */
+    struct thread *thread;              /* Thread waiting on it. */
   };
 
+/* Returns true if the waiter in semaphore_elem A_ has a lower
+   priority than the waiter in B_. */
+static bool
+sema_elem_priority_less (const struct list_elem *a_,
+                         const struct list_elem *b_, void *aux UNUSED)
+{
+  const struct semaphore_elem *a = list_entry (a_, struct semaphore_elem,
+                                               elem);
+  const struct semaphore_elem *b = list_entry (b_, struct semaphore_elem,
+                                               elem);
+
+  return a->thread->priority < b->thread->priority;
+}
+
 /* Initializes condition variable COND.  A condition variable
    allows one piece of code to signal a condition and cooperating
    code to receive the signal and act upon it. */
@@ -295,6 +538,7 @@ cond_wait (struct condition *cond, struct lock *lock)
   ASSERT (lock_held_by_current_thread (lock));
   
   sema_init (&waiter.semaphore, 0);
+  waiter.thread = thread_current ();
   list_push_back (&cond->waiters, &waiter.elem);
   lock_release (lock);
   sema_down (&waiter.semaphore);
@@ -302,8 +546,8 @@ cond_wait (struct condition *cond, struct lock *lock)
 }
 
 /* If any threads are waiting on COND (protected by LOCK), then
-   this function signals one of them to wake up from its wait.
-   LOCK must be held before calling this function.
+   this function signals the highest-priority one to wake up from
+   its wait.  LOCK must be held before calling this function.
 
    An interrupt handler cannot acquire a lock, so it does not
    make sense to try to signal a condition variable within an
@@ -317,8 +561,12 @@ cond_signal (struct condition *cond, struct lock *lock UNUSED)
   ASSERT (lock_held_by_current_thread (lock));
 
   if (!list_empty (&cond->waiters)) 
-    sema_up (&list_entry (list_pop_front (&cond->waiters),
-                          struct semaphore_elem, elem)->semaphore);
+    {
+      struct list_elem *e = list_max (&cond->waiters,
+                                      sema_elem_priority_less, NULL);
+      list_remove (e);
+      sema_up (&list_entry (e, struct semaphore_elem, elem)->semaphore);
+    }
 }
 
 /* Wakes up all threads, if any, waiting on COND (protected by
@@ -336,3 +584,259 @@ cond_broadcast (struct condition *cond, struct lock *lock)
   while (!list_empty (&cond->waiters))
     cond_signal (cond, lock);
 }
+
+/* Initializes RWLOCK.  A readers-writer lock may be held by any
+   number of readers at once, or by a single writer.
+
+   Writers are preferred: once a writer is waiting, newly
+   arriving readers wait too, so a steady stream of readers
+   cannot starve writers.  To keep writers from starving readers
+   in turn, a writer that releases the lock while readers are
+   waiting admits all of those readers ahead of any other
+   writer. */
+void
+rwlock_init (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  lock_init (&rw->lock);
+  cond_init (&rw->readers_ok);
+  cond_init (&rw->writers_ok);
+  rw->readers = 0;
+  rw->waiting_readers = 0;
+  rw->admitted_readers = 0;
+  rw->admit_gen = 0;
+  rw->waiting_writers = 0;
+  rw->writer = NULL;
+  rw->stats = NULL;
+  rw->acquire_time = 0;
+}
+
+/* Names RW, so that if lock statistics are enabled, its
+   acquisitions and waits are recorded under NAME, along with
+   how long writers hold it.  NAME must remain valid for as long
+   as the kernel runs. */
+void
+rwlock_set_name (struct rwlock *rw, const char *name)
+{
+  ASSERT (rw != NULL);
+
+  rw->stats = stats_lookup (name);
+}
+
+/* Acquires RW for reading, sleeping until no writer holds it and
+   no writer is waiting for it (unless this reader was admitted
+   ahead of waiting writers).
+
+   Only readers that were already waiting when a writer released
+   RW belong to the admitted batch.  Each reader notes admit_gen
+   on arrival, and a changed value tells it that it was
+   admitted, so a reader that arrives later cannot take an
+   admitted reader's place. */
+void
+rwlock_acquire_read (struct rwlock *rw)
+{
+  bool contended = false;
+  int64_t start = 0;
+  unsigned gen;
+
+  ASSERT (rw != NULL);
+  ASSERT (rw->writer != thread_current ());
+
+  lock_acquire (&rw->lock);
+  if (rw->stats != NULL)
+    start = timer_ns ();
+  rw->waiting_readers++;
+  gen = rw->admit_gen;
+  while (rw->writer != NULL
+         || (rw->waiting_writers > 0 && rw->admit_gen == gen))
+    {
+      contended = true;
+      cond_wait (&rw->readers_ok, &rw->lock);
+    }
+  rw->waiting_readers--;
+  if (rw->admit_gen != gen)
+    {
+      ASSERT (rw->admitted_readers > 0);
+      rw->admitted_readers--;
+    }
+  rw->readers++;
+  if (rw->stats != NULL)
+    stats_acquired (rw->stats, contended, start, timer_ns ());
+  lock_release (&rw->lock);
+}
+
+/* Releases RW, which the current thread holds for reading. */
+void
+rwlock_release_read (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  lock_acquire (&rw->lock);
+  ASSERT (rw->readers > 0);
+  if (--rw->readers == 0 && rw->waiting_writers > 0)
+    cond_signal (&rw->writers_ok, &rw->lock);
+  lock_release (&rw->lock);
+}
+
+/* Acquires RW for writing, sleeping until no other thread holds
+   it and no admitted readers are still on their way in. */
+void
+rwlock_acquire_write (struct rwlock *rw)
+{
+  bool contended = false;
+  int64_t start = 0;
+
+  ASSERT (rw != NULL);
+  ASSERT (rw->writer != thread_current ());
+
+  lock_acquire (&rw->lock);
+  if (rw->stats != NULL)
+    start = timer_ns ();
+  rw->waiting_writers++;
+  while (rw->writer != NULL || rw->readers > 0 || rw->admitted_readers > 0)
+    {
+      contended = true;
+      cond_wait (&rw->writers_ok, &rw->lock);
+    }
+  rw->waiting_writers--;
+  rw->writer = thread_current ();
+  if (rw->stats != NULL)
+    {
+      rw->acquire_time = timer_ns ();
+      stats_acquired (rw->stats, contended, start, rw->acquire_time);
+    }
+  lock_release (&rw->lock);
+}
+
+/* Releases RW, which the current thread holds for writing.
+   Waiting readers, if any, go next; otherwise one waiting writer
+   does. */
+void
+rwlock_release_write (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  lock_acquire (&rw->lock);
+  ASSERT (rw->writer == thread_current ());
+  if (rw->stats != NULL)
+    stats_released (rw->stats, rw->acquire_time);
+  rw->writer = NULL;
+  if (rw->waiting_readers > 0)
+    {
+      rw->admitted_readers = rw->waiting_readers;
+      rw->admit_gen++;
+      cond_broadcast (&rw->readers_ok, &rw->lock);
+    }
+  else if (rw->waiting_writers > 0)
+    cond_signal (&rw->writers_ok, &rw->lock);
+  lock_release (&rw->lock);
+}
+
+/* Returns true if the current thread holds RW for writing.
+   (Read holders are not tracked, so there is no equivalent test
+   for readers.) */
+bool
+rwlock_held_for_write (const struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  return rw->writer == thread_current ();
+}
+
+/* Returns the statistics for locks named NAME, creating them if
+   necessary.  Returns a null pointer if lock statistics are
+   disabled or the table is full, so that locks pay for the
+   instrumentation only when it is in use. */
+static struct lock_stats *
+stats_lookup (const char *name)
+{
+  struct lock_stats *s = NULL;
+  enum intr_level old_level;
+  size_t i;
+
+  ASSERT (name != NULL);
+
+  if (!lock_stats_enabled)
+    return NULL;
+
+  old_level = intr_disable ();
+  for (i = 0; i < stats_cnt; i++)
+    if (!strcmp (stats_table[i].name, name))
+      {
+        s = &stats_table[i];
+        break;
+      }
+  if (s == NULL && stats_cnt < LOCK_STATS_MAX)
+    {
+      s = &stats_table[stats_cnt++];
+      s->name = name;
+    }
+  intr_set_level (old_level);
+
+  if (s == NULL)
+    printf ("lock statistics table full, not tracking \"%s\"\n", name);
+  return s;
+}
+
+/* Records in S an acquisition that began waiting at START and
+   succeeded at NOW, and that had to wait if CONTENDED is
+   true. */
+static void
+stats_acquired (struct lock_stats *s, bool contended,
+                int64_t start, int64_t now)
+{
+  int64_t wait = now - start;
+  enum intr_level old_level = intr_disable ();
+
+  s->acquire_cnt++;
+  if (contended)
+    {
+      s->contended_cnt++;
+      s->wait_total += wait;
+      if (wait > s->wait_max)
+        s->wait_max = wait;
+    }
+  intr_set_level (old_level);
+}
+
+/* Records in S the release of a lock acquired at START. */
+static void
+stats_released (struct lock_stats *s, int64_t start)
+{
+  int64_t hold = timer_ns () - start;
+  enum intr_level old_level = intr_disable ();
+
+  s->hold_total += hold;
+  if (hold > s->hold_max)
+    s->hold_max = hold;
+  intr_set_level (old_level);
+}
+
+/* Prints lock statistics, if they are enabled.  Times are in
+   microseconds. */
+void
+lock_print_stats (void)
+{
+  size_t i;
+
+  if (!lock_stats_enabled)
+    return;
+
+  for (i = 0; i < stats_cnt; i++)
+    {
+      struct lock_stats s;
+      enum intr_level old_level;
+
+      old_level = intr_disable ();
+      s = stats_table[i];
+      intr_set_level (old_level);
+
+      printf ("Lock: %-16s %llu acquires, %llu contended, "
+              "wait %"PRId64" us (max %"PRId64"), "
+              "hold %"PRId64" us (max %"PRId64")\n",
+              s.name, s.acquire_cnt, s.contended_cnt,
+              s.wait_total / 1000, s.wait_max / 1000,
+              s.hold_total / 1000, s.hold_max / 1000);
+    }
+}
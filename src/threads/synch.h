@@ -3,15 +3,27 @@
 
 #include <list.h>
 #include <stdbool.h>
+#include <stdint.h>
+
+/* Contention statistics for a named lock.  See synch.c. */
+struct lock_stats;
+
+/* If true, named locks and semaphores keep contention
+   statistics.  Set by the "-lockstat" kernel option. */
+extern bool lock_stats_enabled;
+
+void lock_print_stats (void);
 
 /* A counting semaphore. */
 struct semaphore 
   {
     unsigned value;             /* Current value. */
     struct list waiters;        /* List of waiting threads. */
+    struct lock_stats *stats;   /* Statistics, or null if not named. */
   };
 
 void sema_init (struct semaphore *, unsigned value);
+void sema_set_name (struct semaphore *, const char *name);
 void sema_down (struct semaphore *);
 bool sema_try_down (struct semaphore *);
 void sema_up (struct semaphore *);
@@ -22,10 +34,14 @@ struct lock
   {
     struct thread *holder;      /* Thread holding lock (for debugging). */
     struct semaphore semaphore; /* Binary semaphore controlling access. */
+    struct lock_stats *stats;   /* Statistics, or null if not named. */
+    int64_t acquire_time;       /* timer_ns() when last acquired. */
   };
 
 void lock_init (struct lock *);
+void lock_set_name (struct lock *, const char *name);
 void lock_acquire (struct lock *);
+void lock_acquire_adaptive (struct lock *);
 bool lock_try_acquire (struct lock *);
 void lock_release (struct lock *);
 bool lock_held_by_current_thread (const struct lock *);
@@ -41,6 +57,30 @@ void cond_wait (struct condition *, struct lock *);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
 
+/* Readers-writer lock. */
+struct rwlock
+  {
+    struct lock lock;           /* Protects the members below. */
+    struct condition readers_ok; /* Signaled when readers may enter. */
+    struct condition writers_ok; /* Signaled when a writer may enter. */
+    int readers;                /* Readers holding the lock. */
+    int waiting_readers;        /* Readers waiting for the lock. */
+    int admitted_readers;       /* Waiting readers let past writers. */
+    unsigned admit_gen;         /* Incremented on each admission. */
+    int waiting_writers;        /* Writers waiting for the lock. */
+    struct thread *writer;      /* Writer holding the lock, if any. */
+    struct lock_stats *stats;   /* Statistics, or null if not named. */
+    int64_t acquire_time;       /* timer_ns() when writer acquired. */
+  };
+
+void rwlock_init (struct rwlock *);
+void rwlock_set_name (struct rwlock *, const char *name);
+void rwlock_acquire_read (struct rwlock *);
+void rwlock_release_read (struct rwlock *);
+void rwlock_acquire_write (struct rwlock *);
+void rwlock_release_write (struct rwlock *);
+bool rwlock_held_for_write (const struct rwlock *);
+
 /* Optimization barrier.
 
    The compiler will not reorder operations across an
@@ -10,18 +10,27 @@
 #include "threads/palloc.h"
 #include "threads/switch.h"
 #include "threads/synch.h"
+#include "threads/trace.h"
 #include "threads/vaddr.h"
 #include "threads/malloc.h"
+#include "threads/slab.h"
+#include "devices/timer.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #endif
 #include "filesys/filesys.h"
+#ifdef FILESYS
+#include "filesys/directory.h"
+#endif
 
 /* Random value for struct thread's `magic' member.
    Used to detect stack overflow.  See the big comment at the top
    of thread.h for details. */
 #define THREAD_MAGIC 0xcd6abf4b
 
+/* Cache of `struct child', allocated for every new thread. */
+struct kmem_cache *child_cache;
+
 /* List of processes in THREAD_READY state, that is, processes
    that are ready to run but not actually running. */
 static struct list ready_list;
@@ -56,6 +65,10 @@ static long long user_ticks;    /* # of timer ticks in user programs. */
 #define TIME_SLICE 4            /* # of timer ticks to give each thread. */
 static unsigned thread_ticks;   /* # of timer ticks since last yield. */
 
+/* MLFQS system load average, an estimate of the number of
+   threads ready to run over the past minute. */
+static fixed_t load_avg;
+
 /* If false (default), use round-robin scheduler.
    If true, use multi-level feedback queue scheduler.
    Controlled by kernel command-line option "-o mlfqs". */
@@ -72,6 +85,10 @@ static void *alloc_frame (struct thread *, size_t size);
 static void schedule (void);
 void thread_schedule_tail (struct thread *prev);
 static tid_t allocate_tid (void);
+static void mlfqs_update_load_avg (void);
+static void mlfqs_update_recent_cpu (struct thread *, void *aux);
+static void mlfqs_update_priority (struct thread *, void *aux);
+static list_less_func donor_priority_less;
 
 /* Initializes the threading system by transforming the code
    that's currently running into a thread.  This can't work in
@@ -93,8 +110,10 @@ thread_init (void)
 
   lock_init (&tid_lock);
   lock_init (&child_lock);
+  lock_set_name (&child_lock, "child_lock");
   list_init (&ready_list);
   list_init (&all_list);
+  child_cache = kmem_cache_create ("child", sizeof (struct child), NULL);
 
   /* Set up a thread structure for the running thread. */
   initial_thread = running_thread ();
@@ -122,14 +141,16 @@ thread_start (void)
 }
 
 /* Called by the timer interrupt handler at each timer tick.
-   Thus, this function runs in an external interrupt context. */
+   Thus, this function runs in an external interrupt context.
+   USER is true if the tick interrupted user code. */
 void
-thread_tick (void)
+thread_tick (bool user)
 {
   struct thread *t = thread_current ();
+  bool idle = t == idle_thread;
 
   /* Update statistics. */
-  if (t == idle_thread)
+  if (idle)
     idle_ticks++;
 #ifdef USERPROG
   else if (t->pagedir != NULL)
@@ -137,9 +158,48 @@ thread_tick (void)
 #endif
   else
     kernel_ticks++;
+  if (!idle)
+    {
+      if (user)
+        t->usage.user_ticks++;
+      else
+        t->usage.kernel_ticks++;
+    }
 
-  /* Enforce preemption. */
-  if (++thread_ticks >= TIME_SLICE)
+  if (thread_mlfqs)
+    {
+      int64_t now = timer_ticks ();
+
+      if (!idle)
+        t->recent_cpu = fp_add_int (t->recent_cpu, 1);
+
+      /* Once per second, decay every thread's recent_cpu and
+         recompute all priorities.  Between those points only the
+         running thread's recent_cpu changes, so only its
+         priority needs refreshing every fourth tick. */
+      if (now % TIMER_FREQ == 0)
+        {
+          mlfqs_update_load_avg ();
+          thread_foreach (mlfqs_update_recent_cpu, NULL);
+          thread_foreach (mlfqs_update_priority, NULL);
+          thread_preempt ();
+        }
+      else if (now % TIME_SLICE == 0 && !idle)
+        {
+          mlfqs_update_priority (t, NULL);
+          thread_preempt ();
+        }
+    }
+
+  /* Enforce preemption.  The idle thread has no time slice to
+     enforce: it only needs to give way once something became
+     ready, so idle ticks skip the periodic reschedule. */
+  if (idle)
+    {
+      if (!list_empty (&ready_list))
+        intr_yield_on_return ();
+    }
+  else if (++thread_ticks >= TIME_SLICE)
     intr_yield_on_return ();
 }
 
@@ -151,6 +211,20 @@ thread_print_stats (void)
           idle_ticks, kernel_ticks, user_ticks);
 }
 
+/* Adds the resource usage in SRC to DST. */
+void
+rusage_add (struct rusage *dst, const struct rusage *src)
+{
+  dst->user_ticks += src->user_ticks;
+  dst->kernel_ticks += src->kernel_ticks;
+  dst->io_wait_ns += src->io_wait_ns;
+  dst->bytes_read += src->bytes_read;
+  dst->bytes_written += src->bytes_written;
+  dst->voluntary_switches += src->voluntary_switches;
+  dst->involuntary_switches += src->involuntary_switches;
+  dst->page_faults += src->page_faults;
+}
+
 /* Creates a new kernel thread named NAME with the given initial
    PRIORITY, which executes FUNCTION passing AUX as the argument,
    and adds it to the ready queue.  Returns the thread identifier
@@ -163,9 +237,8 @@ thread_print_stats (void)
    scheduled.  Use a semaphore or some other form of
    synchronization if you need to ensure ordering.
 
-   The code provided sets the new thread's `priority' member to
-   PRIORITY, but no actual priority scheduling is implemented.
-   Priority scheduling is the goal of Problem 1-3. */
+   If the new thread has a higher priority than the running
+   thread, the running thread yields to it immediately. */
 tid_t
 thread_create (const char *name, int priority,
                thread_func *function, void *aux)
@@ -188,7 +261,7 @@ thread_create (const char *name, int priority,
   tid = t->tid = allocate_tid ();
 
   /*initialize child struct to add to parent */
-  struct child *new_child = (struct child *)malloc(sizeof(struct child));
+  struct child *new_child = kmem_cache_alloc (child_cache);
   new_child->exited      = false;
   new_child->waited_on   = false;
   new_child->tid         = tid;
@@ -223,6 +296,7 @@ thread_create (const char *name, int priority,
 
   /* Add to run queue. */
   thread_unblock (t);
+  thread_preempt ();
 
   return tid;
 }
@@ -247,10 +321,11 @@ thread_block (void)
    This is an error if T is not blocked.  (Use thread_yield() to
    make the running thread ready.)
 
-   This function does not preempt the running thread.  This can
-   be important: if the caller had disabled interrupts itself,
-   it may expect that it can atomically unblock a thread and
-   update other data. */
+   This function does not preempt the running thread, even if T
+   has a higher priority.  This can be important: if the caller
+   had disabled interrupts itself, it may expect that it can
+   atomically unblock a thread and update other data.  Call
+   thread_preempt() afterward to give up the CPU if needed. */
 void
 thread_unblock (struct thread *t)
 {
@@ -354,49 +429,205 @@ thread_foreach (thread_action_func *func, void *aux)
     }
 }
 
-/* Sets the current thread's priority to NEW_PRIORITY. */
+/* Sets the current thread's base priority to NEW_PRIORITY.
+   Donations currently received still apply, so the effective
+   priority never drops below the highest donor's.  Yields if
+   some ready thread now has a higher priority. */
 void
 thread_set_priority (int new_priority)
 {
-  thread_current ()->priority = new_priority;
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
+  ASSERT (PRI_MIN <= new_priority && new_priority <= PRI_MAX);
+
+  /* The MLFQS scheduler computes priorities itself. */
+  if (thread_mlfqs)
+    return;
+
+  old_level = intr_disable ();
+  cur->base_priority = new_priority;
+  thread_update_priority (cur);
+  intr_set_level (old_level);
+
+  thread_preempt ();
 }
 
-/* Returns the current thread's priority. */
+/* Returns the current thread's effective priority. */
 int
 thread_get_priority (void)
 {
   return thread_current ()->priority;
 }
 
-/* Sets the current thread's nice value to NICE. */
+/* Recomputes T's effective priority as the maximum of its base
+   priority and the priorities of the threads donating to it.
+   Must be called with interrupts off. */
+void
+thread_update_priority (struct thread *t)
+{
+  int priority = t->base_priority;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (!list_empty (&t->donors))
+    {
+      struct thread *donor = list_entry (list_max (&t->donors,
+                                                   donor_priority_less,
+                                                   NULL),
+                                         struct thread, donor_elem);
+      if (donor->priority > priority)
+        priority = donor->priority;
+    }
+  t->priority = priority;
+}
+
+/* Yields the CPU if a ready thread has a higher priority than
+   the running thread.  In an interrupt handler, the yield is
+   deferred until the handler returns. */
 void
-thread_set_nice (int nice UNUSED)
+thread_preempt (void)
+{
+  enum intr_level old_level = intr_disable ();
+  bool yield = false;
+
+  if (!list_empty (&ready_list))
+    {
+      struct thread *t = list_entry (list_max (&ready_list,
+                                               thread_priority_less, NULL),
+                                     struct thread, elem);
+      yield = t->priority > running_thread ()->priority;
+    }
+  intr_set_level (old_level);
+
+  if (yield)
+    {
+      if (intr_context ())
+        intr_yield_on_return ();
+      else
+        thread_yield ();
+    }
+}
+
+/* Returns true if the thread containing list element A_ has a
+   lower priority than the one containing B_.  Works for threads
+   in the ready list or a semaphore's waiters (via `elem'). */
+bool
+thread_priority_less (const struct list_elem *a_,
+                      const struct list_elem *b_, void *aux UNUSED)
 {
-  /* Not yet implemented. */
+  const struct thread *a = list_entry (a_, struct thread, elem);
+  const struct thread *b = list_entry (b_, struct thread, elem);
+
+  return a->priority < b->priority;
+}
+
+/* Returns true if the thread containing donor list element A_
+   has a lower priority than the one containing B_. */
+static bool
+donor_priority_less (const struct list_elem *a_,
+                     const struct list_elem *b_, void *aux UNUSED)
+{
+  const struct thread *a = list_entry (a_, struct thread, donor_elem);
+  const struct thread *b = list_entry (b_, struct thread, donor_elem);
+
+  return a->priority < b->priority;
+}
+
+/* Sets the current thread's nice value to NICE, clamped to
+   NICE_MIN...NICE_MAX, and recomputes its priority.  Yields if
+   the thread no longer has the highest priority. */
+void
+thread_set_nice (int nice)
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
+  if (nice < NICE_MIN)
+    nice = NICE_MIN;
+  else if (nice > NICE_MAX)
+    nice = NICE_MAX;
+
+  old_level = intr_disable ();
+  cur->nice = nice;
+  if (thread_mlfqs)
+    mlfqs_update_priority (cur, NULL);
+  intr_set_level (old_level);
+
+  thread_preempt ();
 }
 
 /* Returns the current thread's nice value. */
 int
 thread_get_nice (void)
 {
-  /* Not yet implemented. */
-  return 0;
+  return thread_current ()->nice;
 }
 
 /* Returns 100 times the system load average. */
 int
 thread_get_load_avg (void)
 {
-  /* Not yet implemented. */
-  return 0;
+  enum intr_level old_level = intr_disable ();
+  int load = fp_round (load_avg * 100);
+  intr_set_level (old_level);
+  return load;
 }
 
 /* Returns 100 times the current thread's recent_cpu value. */
 int
 thread_get_recent_cpu (void)
 {
-  /* Not yet implemented. */
-  return 0;
+  enum intr_level old_level = intr_disable ();
+  int recent_cpu = fp_round (thread_current ()->recent_cpu * 100);
+  intr_set_level (old_level);
+  return recent_cpu;
+}
+
+/* Updates the system load average:
+     load_avg = (59/60)*load_avg + (1/60)*ready_threads,
+   where ready_threads counts the running thread (unless idle)
+   and the threads in the run queue. */
+static void
+mlfqs_update_load_avg (void)
+{
+  int ready_threads = list_size (&ready_list);
+
+  if (running_thread () != idle_thread)
+    ready_threads++;
+  load_avg = (59 * load_avg + fp_from_int (ready_threads)) / 60;
+}
+
+/* Decays T's recent_cpu:
+     recent_cpu = (2*load_avg)/(2*load_avg + 1)*recent_cpu + nice.
+   Suitable for thread_foreach(). */
+static void
+mlfqs_update_recent_cpu (struct thread *t, void *aux UNUSED)
+{
+  fixed_t twice_load = 2 * load_avg;
+  fixed_t coeff = fp_div (twice_load, fp_add_int (twice_load, 1));
+
+  if (t == idle_thread)
+    return;
+  t->recent_cpu = fp_add_int (fp_mul (coeff, t->recent_cpu), t->nice);
+}
+
+/* Recomputes T's priority from its recent_cpu and nice value:
+     priority = PRI_MAX - recent_cpu/4 - nice*2,
+   clamped to PRI_MIN...PRI_MAX.  Suitable for thread_foreach(). */
+static void
+mlfqs_update_priority (struct thread *t, void *aux UNUSED)
+{
+  int priority;
+
+  if (t == idle_thread)
+    return;
+  priority = PRI_MAX - fp_to_int (t->recent_cpu / 4) - t->nice * 2;
+  if (priority < PRI_MIN)
+    priority = PRI_MIN;
+  else if (priority > PRI_MAX)
+    priority = PRI_MAX;
+  t->priority = t->base_priority = priority;
 }
 
 /* Idle thread.  Executes when no other thread is ready to run.
@@ -487,17 +718,35 @@ init_thread (struct thread *t, const char *name, int priority)
   t->status = THREAD_BLOCKED;
   strlcpy (t->name, name, sizeof t->name);
   t->stack = (uint8_t *) t + PGSIZE;
-  t->priority = priority;
+  t->priority = t->base_priority = priority;
+  t->waiting_lock = NULL;
+  list_init (&t->donors);
   t->magic = THREAD_MAGIC;
 
+  /* A new thread inherits its creator's nice value and
+     recent_cpu.  The initial thread starts at zero for both. */
+  if (thread_mlfqs && t != running_thread ())
+    {
+      struct thread *parent = running_thread ();
+      t->nice = parent->nice;
+      t->recent_cpu = parent->recent_cpu;
+      mlfqs_update_priority (t, NULL);
+    }
+  else
+    {
+      t->nice = NICE_DEFAULT;
+      t->recent_cpu = 0;
+    }
+
   old_level = intr_disable ();
   list_push_back (&all_list, &t->allelem);
 
   sema_init(&t->waiting_sema, 0);
   sema_init(&t->loading_sema, 0);
   list_init(&t->children);
-  list_init(&t->file_table);
-  t->free_fd = 2;
+#ifdef USERPROG
+  fd_table_init(&t->fd_table);
+#endif
   t->exit_info = NULL;
   t->exec = NULL;
   t->parent = NULL;
@@ -523,19 +772,32 @@ alloc_frame (struct thread *t, size_t size)
    return a thread from the run queue, unless the run queue is
    empty.  (If the running thread can continue running, then it
    will be in the run queue.)  If the run queue is empty, return
-   idle_thread. */
+   idle_thread.
+
+   The highest-priority ready thread is chosen.  Priorities can
+   change while a thread sits in the run queue (through
+   donation), so the queue is kept unordered and scanned here;
+   among equal priorities the earliest queued thread wins, which
+   gives round-robin behavior. */
 static struct thread *
 next_thread_to_run (void)
 {
   if (list_empty (&ready_list))
     return idle_thread;
   else
-    return list_entry (list_pop_front (&ready_list), struct thread, elem);
+    {
+      struct list_elem *e = list_max (&ready_list, thread_priority_less,
+                                      NULL);
+      list_remove (e);
+      return list_entry (e, struct thread, elem);
+    }
 }
 
+#ifdef FILESYS
 struct dir * thread_cwd(){
   return dir_open(inode_open(thread_current()->cwd));
 }
+#endif
 
 /* Completes a thread switch by activating the new thread's page
    tables, and, if the previous thread is dying, destroying it.
@@ -566,6 +828,9 @@ thread_schedule_tail (struct thread *prev)
   /* Start new time slice. */
   thread_ticks = 0;
 
+  if (prev != NULL)
+    trace (TRACE_SWITCH, prev->tid, prev->status);
+
 #ifdef USERPROG
   /* Activate the new address space. */
   process_activate ();
@@ -603,7 +868,15 @@ schedule (void)
   ASSERT (is_thread (next));
 
   if (cur != next)
-    prev = switch_threads (cur, next);
+    {
+      /* A thread that blocked gave up the CPU by choice; one that
+         is still ready to run was preempted. */
+      if (cur->status == THREAD_BLOCKED)
+        cur->usage.voluntary_switches++;
+      else if (cur->status == THREAD_READY)
+        cur->usage.involuntary_switches++;
+      prev = switch_threads (cur, next);
+    }
   thread_schedule_tail (prev);
 }
 
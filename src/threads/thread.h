@@ -3,9 +3,13 @@
 
 #include <debug.h>
 #include <list.h>
+#include <rusage.h>
 #include <stdint.h>
 #include "threads/synch.h"
+#include "threads/fixed-point.h"
+#include "threads/slab.h"
 #include "devices/block.h"
+#include "userprog/fdtable.h"
 
 /* States in a thread's life cycle. */
 enum thread_status
@@ -26,13 +30,20 @@ typedef int tid_t;
 #define PRI_DEFAULT 31                  /* Default priority. */
 #define PRI_MAX 63                      /* Highest priority. */
 
+/* Thread nice values, for the MLFQS scheduler. */
+#define NICE_MIN -20                    /* Nicest. */
+#define NICE_DEFAULT 0                  /* Default nice value. */
+#define NICE_MAX 20                     /* Least nice. */
+
 struct lock child_lock; /* Global lock to protect shared child struct from modification */
+extern struct kmem_cache *child_cache; /* Cache of struct child, in thread.c */
 
 struct child {
   bool exited; /* True if this child has exited */
   bool waited_on; /* True if parent has already waited on this child once before */
   tid_t tid; /* Thread ID of child */
   int exit_status; /* Value that child exited with, if it has exited */
+  struct rusage usage; /* Child's resource usage plus its children's, once it has exited */
   struct semaphore *parent_sema; /* Pointer to semaphore used by parent to sleep while waiting on child */
   //Used during system exit so child's exit_info pointer can be updated
   struct thread *child_ref; /* Pointer to child process which this struct holds info on */
@@ -43,7 +54,6 @@ struct file_descriptor{
   int fd; /* File Descriptor Number */
   struct file *file; /* File which corresponds to FD */
   struct dir *dir; /* directory which corresponds to FD, mutualy exculsive with file */
-  struct list_elem fd_elem; /* List element used to place File Descriptor in thread's file descriptor table */
 };
 /* A kernel thread or user process.
 
@@ -95,12 +105,14 @@ struct file_descriptor{
    the `magic' member of the running thread's `struct thread' is
    set to THREAD_MAGIC.  Stack overflow will normally change this
    value, triggering the assertion. */
-/* The `elem' member has a dual purpose.  It can be an element in
-   the run queue (thread.c), or it can be an element in a
-   semaphore wait list (synch.c).  It can be used these two ways
-   only because they are mutually exclusive: only a thread in the
-   ready state is on the run queue, whereas only a thread in the
-   blocked state is on a semaphore wait list. */
+/* The `elem' member has a triple purpose.  It can be an element
+   in the run queue (thread.c), an element in a semaphore wait
+   list (synch.c), or an element in the sleep queue (timer.c).
+   It can be used these ways only because they are mutually
+   exclusive: only a thread in the ready state is on the run
+   queue, whereas only a thread in the blocked state is on a
+   semaphore wait list or the sleep queue, and a sleeping thread
+   is not waiting on a semaphore. */
 struct thread
   {
     /* Owned by thread.c. */
@@ -108,19 +120,38 @@ struct thread
     enum thread_status status;          /* Thread state. */
     char name[16];                      /* Name (for debugging purposes). */
     uint8_t *stack;                     /* Saved stack pointer. */
-    int priority;                       /* Priority. */
+    int priority;                       /* Effective priority. */
     struct list_elem allelem;           /* List element for all threads list. */
 
-    /* Shared between thread.c and synch.c. */
+    /* Priority donation, owned by synch.c. */
+    int base_priority;                  /* Priority before donations. */
+    struct lock *waiting_lock;          /* Lock we are blocked on, if any. */
+    struct list donors;                 /* Threads donating priority to us. */
+    struct list_elem donor_elem;        /* Element in a holder's donors. */
+
+    /* MLFQS scheduling, owned by thread.c. */
+    int nice;                           /* Niceness, NICE_MIN...NICE_MAX. */
+    fixed_t recent_cpu;                 /* Recently used CPU time. */
+
+    /* Shared between thread.c, synch.c, and timer.c. */
     struct list_elem elem;              /* List element. */
 
+    /* Owned by devices/timer.c. */
+    int64_t wakeup_tick;                /* Tick to wake up at, if asleep. */
+
+    /* Resource usage.  Updated by thread.c, devices/block.c,
+       userprog/exception.c, and userprog/syscall.c. */
+    struct rusage usage;                /* Used by this thread itself. */
+    struct rusage child_usage;          /* Used by waited-for children. */
+
     /* Used by process_wait */
     struct semaphore waiting_sema;
     struct list children; /* list of all children of this thread */
 
     struct child *exit_info; /* pointer to child's info structure held in parent's heap */
-    struct list file_table; /* list of file_descriptors that this thread has opened */
-    int free_fd; /* Next available file descriptor number */
+#ifdef USERPROG
+    struct fd_table fd_table; /* file_descriptors that this thread has opened */
+#endif
 
     /* Used in process.c to determine if a thread's child has loaded */
     bool child_loaded;     /* Boolean used to record if child has loaded */
@@ -148,8 +179,9 @@ extern bool thread_mlfqs;
 void thread_init (void);
 void thread_start (void);
 
-void thread_tick (void);
+void thread_tick (bool user);
 void thread_print_stats (void);
+void rusage_add (struct rusage *, const struct rusage *);
 
 typedef void thread_func (void *aux);
 tid_t thread_create (const char *name, int priority, thread_func *, void *);
@@ -172,6 +204,10 @@ void thread_foreach (thread_action_func *, void *);
 
 int thread_get_priority (void);
 void thread_set_priority (int);
+void thread_update_priority (struct thread *);
+void thread_preempt (void);
+bool thread_priority_less (const struct list_elem *,
+                           const struct list_elem *, void *aux);
 
 int thread_get_nice (void);
 void thread_set_nice (int);
@@ -0,0 +1,165 @@
+#include "threads/trace.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/block.h"
+#include "devices/scratch.h"
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/* Kernel event tracing.
+
+   Printing from inside the kernel goes synchronously through the
+   console and serial port, which is slow enough to change the
+   behavior being observed.  Instead, static tracepoints (see
+   trace() in trace.h) append fixed-size binary records to an
+   in-memory ring, with interrupts disabled only for the few
+   stores that fill in one record.  Once the ring is full, each
+   new record overwrites the oldest.
+
+   Tracing is off unless the kernel is booted with
+   "-trace[=PAGES]".  At power off, trace_dump() writes the ring
+   to the scratch block device, oldest record first, where
+   utils/pintos-trace can decode it.  This reuses the device that
+   "pintos -g" uses to get files, so the two cannot be combined in
+   one run.
+
+   The dump begins with one sector holding a `struct
+   trace_header', followed by the records packed back to back,
+   crossing sector boundaries as necessary. */
+
+/* Identifies a trace dump. */
+#define TRACE_MAGIC "PINTRACE"
+
+/* Version of the dump format. */
+#define TRACE_VERSION 1
+
+/* One traced event.  All fields are little-endian on disk. */
+struct trace_record
+  {
+    int64_t time;               /* timer_ns() when recorded. */
+    uint32_t type;              /* A TRACE_* value. */
+    int32_t tid;                /* Running thread. */
+    uint32_t arg0;              /* First argument. */
+    uint32_t arg1;              /* Second argument. */
+  };
+
+/* Header at the start of a dump. */
+struct trace_header
+  {
+    char magic[8];              /* TRACE_MAGIC, not null-terminated. */
+    uint32_t version;           /* TRACE_VERSION. */
+    uint32_t record_size;       /* sizeof (struct trace_record). */
+    uint32_t record_cnt;        /* Number of records that follow. */
+    uint32_t lost_cnt;          /* Older records overwritten or cut. */
+  };
+
+size_t trace_pages;
+bool trace_enabled;
+
+/* The ring. */
+static struct trace_record *ring;
+static size_t ring_cap;         /* Capacity, in records. */
+static size_t ring_head;        /* Index of the next record to write. */
+static unsigned long long ring_total; /* Records ever written. */
+
+/* Allocates the trace ring and starts tracing, if the "-trace"
+   option asked for it.  Must be called after palloc_init(). */
+void
+trace_init (void)
+{
+  if (trace_pages == 0)
+    return;
+
+  ring = palloc_get_multiple (0, trace_pages);
+  if (ring == NULL)
+    {
+      printf ("trace: couldn't allocate %zu pages, tracing disabled\n",
+              trace_pages);
+      return;
+    }
+  ring_cap = trace_pages * PGSIZE / sizeof *ring;
+  ring_head = 0;
+  ring_total = 0;
+  trace_enabled = true;
+}
+
+/* Appends an event of TYPE with arguments ARG0 and ARG1 to the
+   ring.  Use trace() instead of calling this directly.  May be
+   called from an interrupt handler. */
+void
+trace_log (enum trace_type type, uint32_t arg0, uint32_t arg1)
+{
+  enum intr_level old_level;
+  struct trace_record *r;
+
+  old_level = intr_disable ();
+  r = &ring[ring_head];
+  if (++ring_head == ring_cap)
+    ring_head = 0;
+  ring_total++;
+
+  r->time = timer_ns ();
+  r->type = type;
+  r->tid = thread_current ()->tid;
+  r->arg0 = arg0;
+  r->arg1 = arg1;
+  intr_set_level (old_level);
+}
+
+/* Stops tracing and writes the ring to the scratch device.  If
+   the device is too small, the oldest records are left out. */
+void
+trace_dump (void)
+{
+  struct trace_header header;
+  size_t cnt, capacity, start, avail;
+
+  if (!trace_enabled)
+    return;
+  trace_enabled = false;
+
+  if (!scratch_dump_open ())
+    {
+      printf ("trace: no scratch device, trace not saved\n");
+      return;
+    }
+  avail = scratch_dump_avail ();
+  if (avail < BLOCK_SECTOR_SIZE)
+    {
+      printf ("trace: scratch device full, trace not saved\n");
+      return;
+    }
+
+  cnt = ring_total < ring_cap ? ring_total : ring_cap;
+  capacity = (avail - BLOCK_SECTOR_SIZE) / sizeof *ring;
+  if (cnt > capacity)
+    cnt = capacity;
+  start = (ring_head + ring_cap - cnt) % ring_cap;
+
+  memset (&header, 0, sizeof header);
+  memcpy (header.magic, TRACE_MAGIC, sizeof header.magic);
+  header.version = TRACE_VERSION;
+  header.record_size = sizeof *ring;
+  header.record_cnt = cnt;
+  header.lost_cnt = ring_total - cnt;
+  scratch_dump_write (&header, sizeof header);
+  scratch_dump_flush ();
+
+  /* The oldest records run from START to the end of the ring,
+     and the rest wrap around to its beginning. */
+  if (start + cnt <= ring_cap)
+    scratch_dump_write (ring + start, cnt * sizeof *ring);
+  else
+    {
+      scratch_dump_write (ring + start, (ring_cap - start) * sizeof *ring);
+      scratch_dump_write (ring, (start + cnt - ring_cap) * sizeof *ring);
+    }
+  scratch_dump_flush ();
+
+  printf ("trace: saved %zu events (%u lost) to scratch device\n",
+          cnt, header.lost_cnt);
+}
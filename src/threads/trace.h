@@ -0,0 +1,49 @@
+#ifndef THREADS_TRACE_H
+#define THREADS_TRACE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Kernel event tracing.  See trace.c. */
+
+/* Event types, with the meaning of their two arguments.  These
+   values appear in trace dumps, so add new types only at the
+   end, and teach utils/pintos-trace about them.  Nothing emits
+   TRACE_EVICT yet, because no project builds vm/. */
+enum trace_type
+  {
+    TRACE_SWITCH,               /* Thread switch: old tid, its status. */
+    TRACE_PAGE_FAULT,           /* Page fault: address, error code. */
+    TRACE_EVICT,                /* Reserved for frame evictions. */
+    TRACE_CACHE_MISS,           /* Buffer cache miss: sector, 0. */
+    TRACE_BLOCK_READ,           /* Block read: sector, block type. */
+    TRACE_BLOCK_WRITE,          /* Block write: sector, block type. */
+    TRACE_SYSCALL               /* System call: number, 0. */
+  };
+
+/* Default size of the trace ring, in pages. */
+#define TRACE_DEFAULT_PAGES 32
+
+/* Size of the trace ring in pages, or 0 if tracing is off.  Set
+   by the "-trace" kernel option. */
+extern size_t trace_pages;
+
+/* True once the trace ring is ready to record events. */
+extern bool trace_enabled;
+
+void trace_init (void);
+void trace_log (enum trace_type, uint32_t arg0, uint32_t arg1);
+void trace_dump (void);
+
+/* Tracepoint: records an event of the given TYPE, with
+   arguments ARG0 and ARG1, if tracing is enabled.  Costs one
+   test and branch otherwise. */
+static inline void
+trace (enum trace_type type, uint32_t arg0, uint32_t arg1)
+{
+  if (trace_enabled)
+    trace_log (type, arg0, arg1);
+}
+
+#endif /* threads/trace.h */
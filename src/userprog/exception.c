@@ -4,6 +4,7 @@
 #include "userprog/gdt.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
 #include "userprog/syscall.h"
 
 /* Number of page faults processed. */
@@ -143,6 +144,8 @@ page_fault (struct intr_frame *f)
 
   /* Count page faults. */
   page_fault_cnt++;
+  thread_current ()->usage.page_faults++;
+  trace (TRACE_PAGE_FAULT, (uint32_t) fault_addr, f->error_code);
 
   /* Determine cause. */
   not_present = (f->error_code & PF_P) == 0;
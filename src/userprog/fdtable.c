@@ -0,0 +1,118 @@
+#include "userprog/fdtable.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/thread.h"
+
+/* Number of slots in a table's first allocation. */
+#define FD_TABLE_MIN 16
+
+/* Descriptors 0 and 1 are the console, never handed out. */
+#define FD_FIRST 2
+
+/* Initializes FD_TABLE as empty.  Allocates nothing, so it is
+   safe to call before malloc() is available. */
+void
+fd_table_init (struct fd_table *fd_table)
+{
+  fd_table->fds = NULL;
+  fd_table->used = NULL;
+  fd_table->size = 0;
+}
+
+/* Grows FD_TABLE to twice its size, or FD_TABLE_MIN slots if it
+   is empty.  Returns true if successful, false if out of
+   memory. */
+static bool
+grow (struct fd_table *fd_table)
+{
+  size_t new_size = fd_table->size > 0 ? fd_table->size * 2 : FD_TABLE_MIN;
+  struct file_descriptor **fds;
+  struct bitmap *used;
+  size_t i;
+
+  fds = realloc (fd_table->fds, new_size * sizeof *fds);
+  if (fds == NULL)
+    return false;
+  fd_table->fds = fds;
+
+  used = bitmap_create (new_size);
+  if (used == NULL)
+    return false;
+  for (i = 0; i < fd_table->size; i++)
+    bitmap_set (used, i, bitmap_test (fd_table->used, i));
+  bitmap_set_multiple (used, 0, FD_FIRST, true);
+  bitmap_destroy (fd_table->used);
+
+  memset (fds + fd_table->size, 0,
+          (new_size - fd_table->size) * sizeof *fds);
+  fd_table->used = used;
+  fd_table->size = new_size;
+  return true;
+}
+
+/* Adds FD to FD_TABLE under the lowest free descriptor number,
+   which is stored in FD->fd and returned.  Returns -1 if out of
+   memory. */
+int
+fd_table_insert (struct fd_table *fd_table, struct file_descriptor *fd)
+{
+  size_t idx = BITMAP_ERROR;
+
+  if (fd_table->used != NULL)
+    idx = bitmap_scan_and_flip (fd_table->used, FD_FIRST, 1, false);
+  if (idx == BITMAP_ERROR)
+    {
+      if (!grow (fd_table))
+        return -1;
+      idx = bitmap_scan_and_flip (fd_table->used, FD_FIRST, 1, false);
+      ASSERT (idx != BITMAP_ERROR);
+    }
+
+  fd_table->fds[idx] = fd;
+  fd->fd = idx;
+  return idx;
+}
+
+/* Returns the open descriptor numbered FD in FD_TABLE, or a null
+   pointer if there is none. */
+struct file_descriptor *
+fd_table_lookup (const struct fd_table *fd_table, int fd)
+{
+  if (fd < 0 || (size_t) fd >= fd_table->size)
+    return NULL;
+  return fd_table->fds[fd];
+}
+
+/* Removes and returns the open descriptor numbered FD in
+   FD_TABLE, making its number free for reuse.  Returns a null
+   pointer if there is none. */
+struct file_descriptor *
+fd_table_remove (struct fd_table *fd_table, int fd)
+{
+  struct file_descriptor *f = fd_table_lookup (fd_table, fd);
+
+  if (f != NULL)
+    {
+      fd_table->fds[fd] = NULL;
+      bitmap_reset (fd_table->used, fd);
+    }
+  return f;
+}
+
+/* Passes every descriptor still open in FD_TABLE to CLOSE, then
+   frees the table's memory.  The table is left empty. */
+void
+fd_table_destroy (struct fd_table *fd_table,
+                  void (*close) (struct file_descriptor *))
+{
+  size_t i;
+
+  for (i = 0; i < fd_table->size; i++)
+    if (fd_table->fds[i] != NULL)
+      close (fd_table->fds[i]);
+  free (fd_table->fds);
+  bitmap_destroy (fd_table->used);
+  fd_table_init (fd_table);
+}
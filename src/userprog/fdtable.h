@@ -0,0 +1,27 @@
+#ifndef USERPROG_FDTABLE_H
+#define USERPROG_FDTABLE_H
+
+#include <stddef.h>
+
+struct bitmap;
+struct file_descriptor;
+
+/* A process's open file descriptors, indexed by fd number.
+   Lookup is a bounds check and an array access.  New
+   descriptors get the lowest free number, found in USED.  The
+   table starts empty and doubles whenever it fills up. */
+struct fd_table
+  {
+    struct file_descriptor **fds;       /* Open descriptors, or null. */
+    struct bitmap *used;                /* Slots in use, including 0 and 1. */
+    size_t size;                        /* Number of slots. */
+  };
+
+void fd_table_init (struct fd_table *);
+int fd_table_insert (struct fd_table *, struct file_descriptor *);
+struct file_descriptor *fd_table_lookup (const struct fd_table *, int fd);
+struct file_descriptor *fd_table_remove (struct fd_table *, int fd);
+void fd_table_destroy (struct fd_table *,
+                       void (*close) (struct file_descriptor *));
+
+#endif /* userprog/fdtable.h */
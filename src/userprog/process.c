@@ -19,6 +19,7 @@
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 #include "threads/malloc.h"
+#include "threads/slab.h"
 #include "threads/synch.h"
 
 static thread_func start_process NO_RETURN;
@@ -137,7 +138,7 @@ void
 remove_child(struct thread *parent, struct child * child_info)
 {
   list_remove(&child_info->child_elem);
-  free(child_info);
+  kmem_cache_free(child_cache, child_info);
   return;
 }
 
@@ -171,6 +172,7 @@ process_wait (tid_t child_tid)
   child_waiting_on->waited_on = true;
 
   if (child_waiting_on->exited == true) {
+    rusage_add(&parent->child_usage, &child_waiting_on->usage);
     lock_release(&child_lock);
     return child_waiting_on->exit_status;
   }
@@ -181,6 +183,7 @@ process_wait (tid_t child_tid)
   sema_down(&parent->waiting_sema);
   lock_acquire(&child_lock);
   int exit_status = child_waiting_on->exit_status;
+  rusage_add(&parent->child_usage, &child_waiting_on->usage);
   lock_release(&child_lock);
 
   //remove_child(parent, child_waiting_on);
@@ -189,23 +192,16 @@ process_wait (tid_t child_tid)
 }
 
 static void
-free_fd_table(struct thread *t)
+close_fd(struct file_descriptor *fd)
 {
-  struct list_elem *e;
-  struct list_elem *next;
-  struct list *fd_table = &t->file_table;
-  struct file_descriptor *fd;
-
-  for (e = list_begin(fd_table); e != list_end(fd_table);)
-  {
-    next = list_next(e);
-
-    fd = list_entry(e, struct file_descriptor, fd_elem);
-    file_close(fd->file);
-    free(fd);
+  file_close(fd->file);
+  kmem_cache_free(fd_cache, fd);
+}
 
-    e = next;
-  }
+static void
+free_fd_table(struct thread *t)
+{
+  fd_table_destroy(&t->fd_table, close_fd);
 }
 
 static void
@@ -224,7 +220,7 @@ free_children(struct thread *t)
     lock_acquire(&child_lock);
     (c->child_ref)->exit_info = NULL;
     lock_release(&child_lock);
-    free(c);
+    kmem_cache_free(child_cache, c);
 
     e = next;
   }
@@ -1,23 +1,34 @@
 #include "userprog/syscall.h"
 #include "userprog/process.h"
+#include "userprog/pagedir.h"
+#include <stdint.h>
 #include <stdio.h>
+#include <cachestat.h>
+#include <ring.h>
+#include <rusage.h>
 #include <syscall-nr.h>
+#include <uio.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 #include "threads/synch.h"
 #include "threads/malloc.h"
+#include "threads/slab.h"
+#include "threads/trace.h"
 #include "threads/palloc.h"
 #include "threads/vaddr.h"
+#include "filesys/cache.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "devices/shutdown.h"
 #include "devices/input.h"
+#include "devices/timer.h"
 #include "lib/string.h"
 
 static void syscall_handler (struct intr_frame *);
 static inline bool get_user (uint8_t *dst, const uint8_t *usrc);
 static inline bool put_user (uint8_t *udst, uint8_t byte);
 static void copy_in (void *dst_, const void *usrc_, size_t size);
+static void copy_out (void *udst_, const void *src_, size_t size);
 static char *copy_in_string (const char *us);
 
 static void sys_halt(void);
@@ -28,7 +39,7 @@ static bool sys_remove (const char *file);
 static int sys_open(const char *file);
 static int sys_filesize(int fd);
 static int sys_read (int fd, void *buffer, unsigned int size);
-static int sys_write (int fd, void *ks, unsigned int size, void *us);
+static int sys_write (int fd, const void *buffer, unsigned int size);
 static void sys_seek(int fd, unsigned int new_pos);
 static unsigned int sys_tell(int fd);
 static void sys_close(int fd);
@@ -38,13 +49,35 @@ static bool sys_mkdir(const char *dir);
 static bool sys_readdir(int fd, char *name);
 static bool sys_isdir(int fd);
 static int sys_inumber(int fd);
-
-static struct file_descriptor* find_fd(struct list * file_table, int fd);
+static int sys_nice(int increment);
+static void sys_clock(int64_t *ns);
+static int sys_readv(int fd, const struct iovec *iov, int iovcnt);
+static int sys_writev(int fd, const struct iovec *iov, int iovcnt);
+static int sys_pread(int fd, void *buffer, unsigned int size,
+                     unsigned int offset);
+static int sys_pwrite(int fd, const void *buffer, unsigned int size,
+                      unsigned int offset);
+static int sys_ring_enter(struct ring *ring);
+static void sys_lock_stats(void);
+static int sys_getrusage(int who, struct rusage *usage);
+static void sys_cache_stats(struct cache_stats *stats);
+static int count_read(int bytes);
+static int count_written(int bytes);
+
+/* Cache of struct file_descriptor. */
+struct kmem_cache *fd_cache;
+
+static struct file_descriptor* find_fd(int fd);
+static void verify_buffer (const void *buffer, unsigned int size,
+                           bool writable);
 
 void
 syscall_init (void)
 {
   lock_init(&file_lock);
+  lock_set_name(&file_lock, "file_lock");
+  fd_cache = kmem_cache_create ("file_descriptor",
+                                sizeof (struct file_descriptor), NULL);
   intr_register_int (0x30, 3, INTR_ON, syscall_handler, "syscall");
 }
 
@@ -54,11 +87,12 @@ syscall_handler (struct intr_frame *f)
 {
   char *ks;
   unsigned call_nr;
-  int args[3];
+  int args[4];
   memset (args, 0, sizeof args);
 
   //stores value at address of esp in call number
   copy_in (&call_nr, f->esp, sizeof call_nr);
+  trace (TRACE_SYSCALL, call_nr, 0);
   //printf("syscall number is %d\n", call_nr);
 
   switch(call_nr) {
@@ -105,14 +139,11 @@ syscall_handler (struct intr_frame *f)
     case SYS_READ:
     	copy_in (args, (uint32_t *) f->esp + 1, (sizeof *args) * 3);
     	//include call to copy buffer into kpage with copy_in_string on args[1]
-      f->eax = sys_read(args[0], (void *)args[1], args[2]);
+      f->eax = count_read(sys_read(args[0], (void *)args[1], args[2]));
       break;
     case SYS_WRITE:
     	copy_in (args, (uint32_t *) f->esp + 1, (sizeof *args) * 3);
-    	//include call to copy buffer into kpage with copy_in_string on args[1]
-      ks = copy_in_string((const char *)args[1]);
-      f->eax = sys_write(args[0], ks, args[2], args[1]);
-      palloc_free_page(ks);
+      f->eax = count_written(sys_write(args[0], (const void *)args[1], args[2]));
       break;
     case SYS_SEEK:
     	copy_in (args, (uint32_t *) f->esp + 1, sizeof *args * 2);
@@ -154,6 +185,50 @@ syscall_handler (struct intr_frame *f)
       copy_in (args, (uint32_t *) f->esp + 1, sizeof *args);
       f->eax = sys_inumber(args[0]);
       break;
+    case SYS_NICE:
+      copy_in (args, (uint32_t *) f->esp + 1, sizeof *args);
+      f->eax = sys_nice(args[0]);
+      break;
+    case SYS_CLOCK:
+      copy_in (args, (uint32_t *) f->esp + 1, sizeof *args);
+      sys_clock((int64_t *) args[0]);
+      break;
+    case SYS_READV:
+      copy_in (args, (uint32_t *) f->esp + 1, sizeof *args * 3);
+      f->eax = count_read(sys_readv(args[0], (const struct iovec *) args[1],
+                                    args[2]));
+      break;
+    case SYS_WRITEV:
+      copy_in (args, (uint32_t *) f->esp + 1, sizeof *args * 3);
+      f->eax = count_written(sys_writev(args[0],
+                                        (const struct iovec *) args[1],
+                                        args[2]));
+      break;
+    case SYS_PREAD:
+      copy_in (args, (uint32_t *) f->esp + 1, sizeof *args * 4);
+      f->eax = count_read(sys_pread(args[0], (void *) args[1], args[2],
+                                    args[3]));
+      break;
+    case SYS_PWRITE:
+      copy_in (args, (uint32_t *) f->esp + 1, sizeof *args * 4);
+      f->eax = count_written(sys_pwrite(args[0], (const void *) args[1],
+                                        args[2], args[3]));
+      break;
+    case SYS_RING_ENTER:
+      copy_in (args, (uint32_t *) f->esp + 1, sizeof *args);
+      f->eax = sys_ring_enter((struct ring *) args[0]);
+      break;
+    case SYS_LOCK_STATS:
+      sys_lock_stats();
+      break;
+    case SYS_GETRUSAGE:
+      copy_in (args, (uint32_t *) f->esp + 1, sizeof *args * 2);
+      f->eax = sys_getrusage(args[0], (struct rusage *) args[1]);
+      break;
+    case SYS_CACHE_STATS:
+      copy_in (args, (uint32_t *) f->esp + 1, sizeof *args);
+      sys_cache_stats((struct cache_stats *) args[0]);
+      break;
   }
 }
 
@@ -193,7 +268,7 @@ sys_mkdir(const char *dir)
 static bool
 sys_readdir(int fd, char *name)
 {
-  struct file_descriptor *f = find_fd(&thread_current()->file_table,fd);
+  struct file_descriptor *f = find_fd(fd);
   if (f == NULL) return false;
   struct dir *dir = f->dir;
   if (dir == NULL) return false;
@@ -208,7 +283,7 @@ sys_readdir(int fd, char *name)
 static bool
 sys_isdir(int fd)
 {
-  struct file_descriptor *f = find_fd(&thread_current()->file_table,fd);
+  struct file_descriptor *f = find_fd(fd);
   if (f == NULL) return false;
   struct dir *dir = f->dir;
   struct inode *inode = file_get_inode(dir);
@@ -220,7 +295,7 @@ sys_isdir(int fd)
 static int
 sys_inumber(int fd)
 {
-  struct file_descriptor *f = find_fd(&thread_current()->file_table,fd);
+  struct file_descriptor *f = find_fd(fd);
   if (f == NULL) return -1;
   struct file *file = f->file;
   struct dir *dir = f->dir;
@@ -237,6 +312,89 @@ sys_inumber(int fd)
   return -1;
 }
 
+/* Adds INCREMENT to the caller's nice value and returns the new
+   value, which the scheduler clamps to NICE_MIN...NICE_MAX.
+   INCREMENT is clamped first so that the sum cannot overflow. */
+static int
+sys_nice(int increment)
+{
+  if (increment < NICE_MIN - NICE_MAX)
+    increment = NICE_MIN - NICE_MAX;
+  else if (increment > NICE_MAX - NICE_MIN)
+    increment = NICE_MAX - NICE_MIN;
+  thread_set_nice(thread_get_nice() + increment);
+  return thread_get_nice();
+}
+
+/* Stores the monotonic clock, in nanoseconds since boot, into
+   the user's *NS.  A 64-bit value does not fit in EAX, so it is
+   returned through memory. */
+static void
+sys_clock(int64_t *ns)
+{
+  int64_t now = timer_ns();
+  copy_out(ns, &now, sizeof now);
+}
+
+/* Prints the kernel's lock contention statistics to the
+   console.  Prints nothing unless the kernel was booted with
+   "-lockstat". */
+static void
+sys_lock_stats(void)
+{
+  lock_print_stats();
+}
+
+/* Stores the resource usage of the caller (if WHO is
+   RUSAGE_SELF) or of its children that it has waited for (if
+   WHO is RUSAGE_CHILDREN) into the user's *USAGE.  Returns 0 if
+   successful, -1 if WHO is invalid. */
+static int
+sys_getrusage(int who, struct rusage *usage)
+{
+  struct thread *cur = thread_current();
+  struct rusage ru;
+
+  if (who == RUSAGE_SELF)
+    ru = cur->usage;
+  else if (who == RUSAGE_CHILDREN)
+    ru = cur->child_usage;
+  else
+    return -1;
+  copy_out(usage, &ru, sizeof ru);
+  return 0;
+}
+
+/* Copies the buffer cache statistics into the user's *STATS. */
+static void
+sys_cache_stats(struct cache_stats *stats)
+{
+  struct cache_stats s;
+
+  cache_get_stats(&s);
+  copy_out(stats, &s, sizeof s);
+}
+
+/* Charges BYTES, the result of a read system call, to the
+   current thread, unless it is an error.  Returns BYTES. */
+static int
+count_read(int bytes)
+{
+  if (bytes > 0)
+    thread_current()->usage.bytes_read += bytes;
+  return bytes;
+}
+
+/* Charges BYTES, the result of a write system call, to the
+   current thread, unless it is an error.  Returns BYTES. */
+static int
+count_written(int bytes)
+{
+  if (bytes > 0)
+    thread_current()->usage.bytes_written += bytes;
+  return bytes;
+}
+
 static void
 sys_halt(void)
 {
@@ -253,6 +411,8 @@ sys_exit(int status)
     lock_acquire(&child_lock);
     child_info->exit_status = status;
     child_info->exited = true;
+    child_info->usage = cur->usage;
+    rusage_add(&child_info->usage, &cur->child_usage);
     if (child_info->parent_sema != NULL){
       sema_up(child_info->parent_sema);
       //printf("waking up parent\n");
@@ -303,13 +463,13 @@ static int
 sys_open(const char *file)
 {
   //Create element for file table
-  struct file_descriptor *fd = (struct file_descriptor *) malloc(sizeof(struct file_descriptor));
+  struct file_descriptor *fd = kmem_cache_alloc(fd_cache);
   struct thread * cur = thread_current();
   lock_acquire(&file_lock);
 	struct file *f = filesys_open(file);
   lock_release(&file_lock);
   if (f == NULL){
-    free(fd);
+    kmem_cache_free(fd_cache, fd);
     return (-1);
   }
   struct inode *inode  = file_get_inode(f);
@@ -321,9 +481,13 @@ sys_open(const char *file)
     fd->dir = NULL;
     fd->file = f;
   }
-  fd->fd = cur->free_fd;
-  cur->free_fd += 1;
-  list_push_front(&cur->file_table,&fd->fd_elem);
+  if (fd_table_insert(&cur->fd_table, fd) < 0){
+    lock_acquire(&file_lock);
+    file_close(f);
+    lock_release(&file_lock);
+    kmem_cache_free(fd_cache, fd);
+    return (-1);
+  }
   return fd->fd;
 }
 
@@ -331,7 +495,7 @@ sys_open(const char *file)
 static int
 sys_filesize(int fd)
 {
-  struct file_descriptor *f = find_fd(&thread_current()->file_table,fd);
+  struct file_descriptor *f = find_fd(fd);
   if (f == NULL)
     return (-1);
   lock_acquire(&file_lock);
@@ -340,22 +504,34 @@ sys_filesize(int fd)
 	return length;
 }
 
-static bool
-verify_buffer(void *buffer, unsigned int size)
+/* Checks that the SIZE bytes of user memory at BUFFER are all
+   mapped in the current process, and writable if WRITABLE, so
+   that the file system can copy straight to or from them.  Looks
+   at each page once.  Calls sys_exit(-1) if any byte is bad. */
+static void
+verify_buffer (const void *buffer, unsigned int size, bool writable)
 {
-  char *temp_buffer = buffer;
+  uint32_t *pd = thread_current ()->pagedir;
+  const uint8_t *start = buffer;
+  const uint8_t *end = start + size;
+  const uint8_t *upage;
 
-  for (; size > 0; size--, temp_buffer++){
-    if (temp_buffer >= (uint8_t *) PHYS_BASE){
+  if (size == 0)
+    return;
+  if (end < start || end > (uint8_t *) PHYS_BASE)
+    sys_exit (-1);
+
+  for (upage = pg_round_down (start); upage < end; upage += PGSIZE)
+    if (writable
+        ? !pagedir_is_writable (pd, upage)
+        : pagedir_get_page (pd, upage) == NULL)
       sys_exit (-1);
-    }
-  }
 }
 
 static int
 sys_read(int fd, void *buffer, unsigned int size)
 {
-  verify_buffer(buffer, size);
+  verify_buffer(buffer, size, true);
 
   struct file_descriptor *f;
   int retval = size;
@@ -363,7 +539,7 @@ sys_read(int fd, void *buffer, unsigned int size)
 
   if (fd != STDIN_FILENO)
   {
-    f = find_fd(&thread_current()->file_table,fd);
+    f = find_fd(fd);
     if (f == NULL) return -1;
     lock_acquire(&file_lock);
     retval = file_read(f->file, buffer, size);
@@ -385,12 +561,14 @@ sys_read(int fd, void *buffer, unsigned int size)
 /* If not, look in file table and write to that file */
 /* Return bytes actually writen */
 static int
-sys_write (int fd, void *ks, unsigned int size, void *us)
+sys_write (int fd, const void *buffer, unsigned int size)
 {
   struct file_descriptor *f;
   int retval = 0;
+
+  verify_buffer(buffer, size, false);
   if (fd == STDOUT_FILENO){
-	  putbuf(ks, size);
+	  putbuf(buffer, size);
     return size;
   }
   else if (fd == STDIN_FILENO)
@@ -399,21 +577,226 @@ sys_write (int fd, void *ks, unsigned int size, void *us)
   }
   else
   {
-    f = find_fd(&thread_current()->file_table,fd);
+    f = find_fd(fd);
     if (f == NULL) return -1;
     if (f->file == NULL) return -1;
     lock_acquire(&file_lock);
-    retval += file_write (f->file, (const void *)us, size);
+    retval += file_write (f->file, buffer, size);
     lock_release(&file_lock);
   }
   return retval;
 }
 
+/* Copies the IOVCNT-element user array UIOV into KIOV and checks
+   every buffer it describes, which must be writable if WRITABLE.
+   Returns false if IOVCNT is out of range; calls sys_exit(-1) for
+   a bad pointer. */
+static bool
+copy_in_iovec(struct iovec kiov[IOV_MAX], const struct iovec *uiov,
+              int iovcnt, bool writable)
+{
+  int i;
+
+  if (iovcnt < 0 || iovcnt > IOV_MAX)
+    return false;
+  copy_in (kiov, uiov, sizeof *kiov * iovcnt);
+  for (i = 0; i < iovcnt; i++)
+    verify_buffer(kiov[i].iov_base, kiov[i].iov_len, writable);
+  return true;
+}
+
+/* Reads from FD into each of the IOVCNT buffers in IOV in turn,
+   stopping early at end of file.  Returns the number of bytes
+   read, or -1 on error. */
+static int
+sys_readv(int fd, const struct iovec *iov, int iovcnt)
+{
+  struct iovec kiov[IOV_MAX];
+  struct file_descriptor *f;
+  int total = 0;
+  int i;
+
+  if (!copy_in_iovec(kiov, iov, iovcnt, true))
+    return -1;
+
+  if (fd == STDIN_FILENO)
+    {
+      for (i = 0; i < iovcnt; i++)
+        {
+          uint8_t *buffer = kiov[i].iov_base;
+          size_t j;
+          for (j = 0; j < kiov[i].iov_len; j++)
+            buffer[j] = input_getc();
+          total += kiov[i].iov_len;
+        }
+      return total;
+    }
+
+  f = find_fd(fd);
+  if (f == NULL || f->file == NULL)
+    return -1;
+  lock_acquire(&file_lock);
+  for (i = 0; i < iovcnt; i++)
+    {
+      off_t n = file_read(f->file, kiov[i].iov_base, kiov[i].iov_len);
+      total += n;
+      if ((size_t) n < kiov[i].iov_len)
+        break;
+    }
+  lock_release(&file_lock);
+  return total;
+}
+
+/* Writes each of the IOVCNT buffers in IOV to FD in turn.
+   Returns the number of bytes written, or -1 on error. */
+static int
+sys_writev(int fd, const struct iovec *iov, int iovcnt)
+{
+  struct iovec kiov[IOV_MAX];
+  struct file_descriptor *f;
+  int total = 0;
+  int i;
+
+  if (!copy_in_iovec(kiov, iov, iovcnt, false))
+    return -1;
+
+  if (fd == STDOUT_FILENO)
+    {
+      for (i = 0; i < iovcnt; i++)
+        {
+          putbuf(kiov[i].iov_base, kiov[i].iov_len);
+          total += kiov[i].iov_len;
+        }
+      return total;
+    }
+
+  f = find_fd(fd);
+  if (f == NULL || f->file == NULL)
+    return -1;
+  lock_acquire(&file_lock);
+  for (i = 0; i < iovcnt; i++)
+    {
+      off_t n = file_write(f->file, kiov[i].iov_base, kiov[i].iov_len);
+      total += n;
+      if ((size_t) n < kiov[i].iov_len)
+        break;
+    }
+  lock_release(&file_lock);
+  return total;
+}
+
+/* Returns true if a transfer of SIZE bytes at byte OFFSET stays
+   within the range of off_t, false otherwise. */
+static bool
+valid_file_range(unsigned int size, unsigned int offset)
+{
+  return offset <= INT32_MAX && size <= INT32_MAX - offset;
+}
+
+/* Reads SIZE bytes from FD at byte OFFSET into BUFFER, without
+   using or changing FD's position.  Returns the number of bytes
+   read, or -1 on error. */
+static int
+sys_pread(int fd, void *buffer, unsigned int size, unsigned int offset)
+{
+  struct file_descriptor *f;
+  int retval;
+
+  verify_buffer(buffer, size, true);
+  f = find_fd(fd);
+  if (f == NULL || f->file == NULL || !valid_file_range(size, offset))
+    return -1;
+  lock_acquire(&file_lock);
+  retval = file_read_at(f->file, buffer, size, offset);
+  lock_release(&file_lock);
+  return retval;
+}
+
+/* Writes SIZE bytes from BUFFER to FD at byte OFFSET, without
+   using or changing FD's position.  Returns the number of bytes
+   written, or -1 on error. */
+static int
+sys_pwrite(int fd, const void *buffer, unsigned int size, unsigned int offset)
+{
+  struct file_descriptor *f;
+  int retval;
+
+  verify_buffer(buffer, size, false);
+  f = find_fd(fd);
+  if (f == NULL || f->file == NULL || !valid_file_range(size, offset))
+    return -1;
+  lock_acquire(&file_lock);
+  retval = file_write_at(f->file, buffer, size, offset);
+  lock_release(&file_lock);
+  return retval;
+}
+
+/* Carries out the request in SQE and returns its result, as the
+   equivalent system call would have. */
+static int
+ring_execute(const struct ring_sqe *sqe)
+{
+  char *ks;
+  int result;
+
+  switch (sqe->op)
+    {
+    case RING_NOP:
+      return 0;
+    case RING_READ:
+      return count_read(sys_read(sqe->fd, sqe->buf, sqe->len));
+    case RING_WRITE:
+      return count_written(sys_write(sqe->fd, sqe->buf, sqe->len));
+    case RING_OPEN:
+      ks = copy_in_string(sqe->buf);
+      result = sys_open(ks);
+      palloc_free_page(ks);
+      return result;
+    case RING_CLOSE:
+      sys_close(sqe->fd);
+      return 0;
+    default:
+      return -1;
+    }
+}
+
+/* Consumes the submissions queued in the user's RING, in order,
+   posting a completion for each, until the submission queue is
+   empty or the completion queue is full.  Returns the number of
+   submissions consumed, or -1 if the ring is inconsistent. */
+static int
+sys_ring_enter(struct ring *ring)
+{
+  int cnt = 0;
+
+  /* The ring stays mapped for the whole call, so after checking
+     it once we can use it in place. */
+  verify_buffer(ring, sizeof *ring, true);
+  if (ring->sq_tail - ring->sq_head > RING_ENTRIES
+      || ring->cq_tail - ring->cq_head > RING_ENTRIES)
+    return -1;
+
+  while (ring->sq_head != ring->sq_tail
+         && ring->cq_tail - ring->cq_head < RING_ENTRIES)
+    {
+      /* Copy the request so that it cannot change under us. */
+      struct ring_sqe sqe = ring->sqes[ring->sq_head % RING_ENTRIES];
+      struct ring_cqe *cqe = &ring->cqes[ring->cq_tail % RING_ENTRIES];
+
+      ring->sq_head++;
+      cqe->user_data = sqe.user_data;
+      cqe->result = ring_execute(&sqe);
+      ring->cq_tail++;
+      cnt++;
+    }
+  return cnt;
+}
+
 static void
 sys_seek(int fd, unsigned int new_pos)
 {
   //search through fd list to change pos to new_pos
-  struct file_descriptor *f = find_fd(&thread_current()->file_table,fd);
+  struct file_descriptor *f = find_fd(fd);
   if (f == NULL)
     return;
   lock_acquire(&file_lock);
@@ -425,7 +808,7 @@ sys_seek(int fd, unsigned int new_pos)
 static unsigned int
 sys_tell(int fd){
   //search through fd list to return the pos value in struct file_descriptor
-  struct file_descriptor *f = find_fd(&thread_current()->file_table,fd);
+  struct file_descriptor *f = find_fd(fd);
   if (f == NULL)
     return 0;
   lock_acquire(&file_lock);
@@ -438,28 +821,18 @@ static void
 sys_close(int fd)
 {
   //remove fd from the current threads file table
-  struct file_descriptor *f = find_fd(&thread_current()->file_table,fd);
+  struct file_descriptor *f = fd_table_remove(&thread_current()->fd_table, fd);
   if (f == NULL)
     return;
-  lock_acquire(&file_lock);
-  list_remove(&f->fd_elem);
-  lock_release(&file_lock);
-  free(f);
+  kmem_cache_free(fd_cache, f);
   return;
 }
 
-//Traverses file table and returns file descriptor with fd number
+//Returns the current thread's file descriptor with fd number
 //Return NULL if not present
 static struct file_descriptor *
-find_fd(struct list * file_table, int fd){
-  struct list_elem *e;
-  struct file_descriptor *f;
-  for (e = list_begin (file_table); e != list_end (file_table); e = list_next (e)){
-    f = list_entry (e, struct file_descriptor, fd_elem);
-    if (f->fd == fd)
-      return f;
-  }
-  return NULL;
+find_fd(int fd){
+  return fd_table_lookup(&thread_current()->fd_table, fd);
 }
 
 /* Copies a byte from user address USRC to kernel address DST.  USRC must
@@ -508,6 +881,23 @@ static void copy_in (void *dst_, const void *usrc_, size_t size) {
 
 
 
+/* Copies SIZE bytes from kernel address SRC to user address UDST.  Call
+   thread_exit() if any of the user accesses are invalid. */
+
+static void copy_out (void *udst_, const void *src_, size_t size) {
+
+  uint8_t *udst = udst_;
+  const uint8_t *src = src_;
+
+  for (; size > 0; size--, udst++, src++){
+    if (udst >= (uint8_t *) PHYS_BASE || !put_user (udst, *src)){
+      sys_exit (-1);
+    }
+  }
+}
+
+
+
 /* Creates a copy of user string US in kernel memory and returns it as a
    page that must be freed with palloc_free_page().  Truncates the string
    at PGSIZE bytes in size.  Call thread_exit() if any of the user accesses
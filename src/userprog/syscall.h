@@ -6,5 +6,8 @@ void syscall_init (void);
 /* Global lock used by calls to file system to protect synchronization */
 struct lock file_lock;
 
+/* Cache of struct file_descriptor, shared with process.c */
+extern struct kmem_cache *fd_cache;
+
 void sys_exit(int status);
 #endif /* userprog/syscall.h */
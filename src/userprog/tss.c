@@ -1,4 +1,5 @@
 #include "userprog/tss.h"
+#include <cpuid.h>
 #include <debug.h>
 #include <stddef.h>
 #include "userprog/gdt.h"
@@ -75,6 +76,18 @@ struct tss
 /* Kernel TSS. */
 static struct tss *tss;
 
+/* Model-specific registers used by SYSENTER.
+   See [IA32-v3a] 4.8.7 "Performing Fast Calls to System
+   Procedures with the SYSENTER and SYSEXIT Instructions". */
+#define MSR_SYSENTER_CS  0x174          /* Kernel code selector. */
+#define MSR_SYSENTER_ESP 0x175          /* Kernel stack pointer. */
+#define MSR_SYSENTER_EIP 0x176          /* Kernel entry point. */
+
+/* Entry point for SYSENTER, in sysenter.S. */
+void sysenter_entry (void);
+
+static void sysenter_init (void);
+
 /* Initializes the kernel TSS. */
 void
 tss_init (void) 
@@ -86,6 +99,7 @@ tss_init (void)
   tss->ss0 = SEL_KDSEG;
   tss->bitmap = 0xdfff;
   tss_update ();
+  sysenter_init ();
 }
 
 /* Returns the kernel TSS. */
@@ -104,3 +118,32 @@ tss_update (void)
   ASSERT (tss != NULL);
   tss->esp0 = (uint8_t *) thread_current () + PGSIZE;
 }
+
+/* Writes VALUE to model-specific register MSR. */
+static inline void
+wrmsr (uint32_t msr, uint32_t value) 
+{
+  asm volatile ("wrmsr" : : "c" (msr), "a" (value), "d" (0));
+}
+
+/* Enables the SYSENTER fast system call path, if the CPU has it.
+   Otherwise user programs keep using "int $0x30".
+
+   SYSENTER does not consult the TSS, so the ESP MSR would
+   otherwise have to be rewritten on every thread switch.
+   Instead we point it at the TSS itself and let sysenter_entry
+   load esp0 from there, which tss_update() already maintains.
+   SYSENTER also derives the kernel stack selector and the user
+   selectors used by SYSEXIT from the CS MSR, which the GDT
+   layout in gdt.c satisfies: SEL_KDSEG, SEL_UCSEG, and
+   SEL_UDSEG follow SEL_KCSEG at 8-byte intervals. */
+static void
+sysenter_init (void) 
+{
+  if (!cpuid_has_sysenter ())
+    return;
+
+  wrmsr (MSR_SYSENTER_CS, SEL_KCSEG);
+  wrmsr (MSR_SYSENTER_ESP, (uint32_t) tss);
+  wrmsr (MSR_SYSENTER_EIP, (uint32_t) sysenter_entry);
+}
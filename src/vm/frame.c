@@ -50,6 +50,7 @@ frame_init (void)
   void *base;
 
   lock_init (&scan_lock);
+  lock_set_name (&scan_lock, "scan_lock");
 
   frames = malloc (sizeof *frames * init_ram_pages);
   if (frames == NULL)
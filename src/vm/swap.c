@@ -63,6 +63,7 @@ swap_init (void)
   if (swap_bitmap == NULL)
     PANIC ("couldn't create swap bitmap");
   lock_init (&swap_lock);
+  lock_set_name (&swap_lock, "swap_lock");
 }
 
 bool